@@ -0,0 +1,52 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "cista/serialization.h"
+
+namespace data = cista::raw;
+
+struct node {
+  std::uint32_t id_{0U};
+  data::vector<data::ptr<node>> edges_;
+  data::string name_;
+};
+
+struct graph {
+  data::vector<data::unique_ptr<node>> nodes_;
+};
+
+template <cista::mode const Mode>
+void run(graph& g, char const* name) {
+  auto b = cista::serialize<Mode>(g);
+
+  auto const start = std::chrono::steady_clock::now();
+  auto const d = cista::deserialize<graph, Mode>(b);
+  auto const stop = std::chrono::steady_clock::now();
+
+  std::printf("%s: nodes=%zu size=%zu bytes deserialize=%.3f s\n", name,
+              static_cast<std::size_t>(d->nodes_.size()), b.size(),
+              std::chrono::duration<double>(stop - start).count());
+}
+
+int main(int argc, char** argv) {
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{2'000'000U};
+
+  auto g = graph{};
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    g.nodes_.emplace_back(data::make_unique<node>());
+    g.nodes_[i]->id_ = static_cast<std::uint32_t>(i);
+    g.nodes_[i]->name_ = data::string{"a node name on the heap"};
+  }
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    g.nodes_[i]->edges_ = {g.nodes_[(i + 1U) % n].get(),
+                           g.nodes_[(i * 7U) % n].get()};
+  }
+
+  run<cista::mode::NONE>(g, "type-directed");
+  run<cista::mode::WITH_RELOCATIONS>(g, "relocations");
+  run<cista::mode::UNCHECKED>(g, "type-directed, unchecked");
+  run<cista::mode::WITH_RELOCATIONS | cista::mode::UNCHECKED>(
+      g, "relocations, unchecked");
+}
@@ -0,0 +1,64 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "cista/containers/hash_map.h"
+
+namespace data = cista::raw;
+
+using map_t = data::hash_map<std::uint64_t, std::uint32_t>;
+
+// Building an id -> index map: emplace() with growth by rehashing,
+// reserve() + emplace(), reserve() + try_emplace() and bulk insert().
+template <typename Fn>
+double seconds(Fn&& fn) {
+  auto const start = std::chrono::steady_clock::now();
+  fn();
+  auto const stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc, char** argv) {
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{16U * 1024U * 1024U};
+
+  auto rng = std::mt19937_64{1U};
+  auto entries = std::vector<map_t::entry_t>{};
+  entries.reserve(n);
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    entries.push_back({rng(), static_cast<std::uint32_t>(i)});
+  }
+
+  auto checksum = std::size_t{0U};
+  auto const run = [&](char const* name, auto&& build) {
+    auto map = map_t{};
+    auto const t = seconds([&]() { build(map); });
+    checksum += map.size();
+    std::printf("%-22s %.2f s (%.0f ns per entry)\n", name, t,
+                t * 1e9 / static_cast<double>(n));
+  };
+
+  std::printf("%zu entries\n", n);
+  run("emplace", [&](map_t& map) {
+    for (auto const& e : entries) {
+      map.emplace(e.first, e.second);
+    }
+  });
+  run("reserve + try_emplace", [&](map_t& map) {
+    map.reserve(n);
+    for (auto const& e : entries) {
+      map.try_emplace(e.first, e.second);
+    }
+  });
+  run("reserve + emplace", [&](map_t& map) {
+    map.reserve(n);
+    for (auto const& e : entries) {
+      map.emplace(e.first, e.second);
+    }
+  });
+  run("insert(first, last)",
+      [&](map_t& map) { map.insert(begin(entries), end(entries)); });
+  std::printf("(%zu)\n", checksum);
+}
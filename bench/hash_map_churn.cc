@@ -0,0 +1,66 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "cista/containers/hash_map.h"
+
+namespace data = cista::raw;
+
+using map_t = data::hash_map<std::uint64_t, std::uint32_t>;
+
+// Long running map with insert/erase churn: a sliding window of `n` live
+// keys. Reports the capacity (memory) and the time per insert + erase and
+// per lookup after each round.
+template <typename Fn>
+double seconds(Fn&& fn) {
+  auto const start = std::chrono::steady_clock::now();
+  fn();
+  auto const stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc, char** argv) {
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{1024U * 1024U};
+  constexpr auto const ROUNDS = 8U;
+
+  auto rng = std::mt19937_64{1U};
+  auto keys = std::vector<std::uint64_t>((ROUNDS + 1U) * n);
+  for (auto& k : keys) {
+    k = rng();
+  }
+
+  auto map = map_t{};
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    map.emplace(keys[i], static_cast<std::uint32_t>(i));
+  }
+
+  auto found = std::size_t{0U};
+  std::printf("%zu live entries\n", n);
+  std::printf("round 0: capacity %llu\n",
+              static_cast<unsigned long long>(map.capacity_));
+  for (auto r = 1U; r <= ROUNDS; ++r) {
+    auto const t_churn = seconds([&]() {
+      for (auto i = r * n; i != (r + 1U) * n; ++i) {
+        map.erase(keys[i - n]);
+        map.emplace(keys[i], static_cast<std::uint32_t>(i));
+      }
+    });
+    auto const t_find = seconds([&]() {
+      for (auto i = r * n; i != (r + 1U) * n; ++i) {
+        found += map.find(keys[i]) != map.end() ? 1U : 0U;
+      }
+    });
+    std::printf(
+        "round %u: capacity %llu, erase + insert %.0f ns, find %.0f ns\n", r,
+        static_cast<unsigned long long>(map.capacity_),
+        t_churn * 1e9 / static_cast<double>(n),
+        t_find * 1e9 / static_cast<double>(n));
+  }
+
+  map.shrink_to_fit();
+  std::printf("shrink_to_fit: capacity %llu (%zu)\n",
+              static_cast<unsigned long long>(map.capacity_), found);
+}
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "cista/containers/hash_map.h"
+
+namespace data = cista::raw;
+
+using map_t = data::hash_map<std::uint64_t, std::uint64_t>;
+
+// find() vs. find_batch() / contains_batch() for a table larger than the
+// last level cache: random keys, half of them not in the table, looked up
+// in requests of `batch` keys (like a request handler would).
+template <typename Fn>
+double ns_per_lookup(std::size_t const n, Fn&& fn) {
+  auto const start = std::chrono::steady_clock::now();
+  fn();
+  auto const stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(stop - start).count() /
+         static_cast<double>(n);
+}
+
+map_t build(std::size_t const n) {
+  auto rng = std::mt19937_64{1U};
+  auto map = map_t{};
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    auto const k = rng();
+    map.emplace(k, k);
+  }
+  return map;
+}
+
+int main(int argc, char** argv) {
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{8U * 1024U * 1024U};
+  auto const batch = argc > 2 ? static_cast<std::size_t>(std::atoll(argv[2]))
+                              : std::size_t{256U};
+  auto const num_lookups = std::size_t{4U * 1024U * 1024U};
+
+  auto const map = build(n);
+
+  auto queries = std::vector<std::uint64_t>{};
+  auto hits = std::mt19937_64{1U};
+  auto misses = std::mt19937_64{2U};
+  auto pick = std::mt19937_64{3U};
+  auto keys = std::vector<std::uint64_t>{};
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    keys.push_back(hits());
+  }
+  for (auto i = std::size_t{0U}; i != num_lookups; ++i) {
+    queries.push_back(i % 2U == 0U ? keys[pick() % n] : misses());
+  }
+
+  auto sum = std::uint64_t{0U};
+  auto const scalar_ns = ns_per_lookup(num_lookups, [&]() {
+    for (auto const k : queries) {
+      auto const it = map.find(k);
+      sum += it == map.end() ? 0U : it->second;
+    }
+  });
+
+  auto found = std::vector<map_t::const_iterator>(batch);
+  auto const batch_ns = ns_per_lookup(num_lookups, [&]() {
+    for (auto i = std::size_t{0U}; i < num_lookups; i += batch) {
+      auto const first = begin(queries) + static_cast<std::ptrdiff_t>(i);
+      auto const last =
+          begin(queries) +
+          static_cast<std::ptrdiff_t>(std::min(i + batch, num_lookups));
+      auto const out_end = map.find_batch(first, last, begin(found));
+      for (auto it = begin(found); it != out_end; ++it) {
+        sum += *it == map.end() ? 0U : (*it)->second;
+      }
+    }
+  });
+
+  auto contained = std::vector<char>(batch);
+  auto count = std::size_t{0U};
+  auto const contains_ns = ns_per_lookup(num_lookups, [&]() {
+    for (auto i = std::size_t{0U}; i < num_lookups; i += batch) {
+      auto const first = begin(queries) + static_cast<std::ptrdiff_t>(i);
+      auto const last =
+          begin(queries) +
+          static_cast<std::ptrdiff_t>(std::min(i + batch, num_lookups));
+      auto const out_end = map.contains_batch(first, last, begin(contained));
+      count += static_cast<std::size_t>(
+          std::count(begin(contained), out_end, char{1}));
+    }
+  });
+
+  std::printf(
+      "%zu entries (%.0f MB), %zu keys per batch: find %.1f ns, "
+      "find_batch %.1f ns, contains_batch %.1f ns per key (%llu, %zu)\n",
+      n,
+      static_cast<double>(map.capacity() * (sizeof(map_t::entry_t) + 1U)) /
+          1e6,
+      batch, scalar_ns, batch_ns, contains_ns,
+      static_cast<unsigned long long>(sum), count);
+}
@@ -0,0 +1,129 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cista/containers/hash_map.h"
+#include "cista/containers/string.h"
+
+namespace data = cista::raw;
+
+// Lookup throughput of cista::hash_map for hits and misses with integer and
+// string keys, for each group width (8: SWAR, 16: SSE2, 32: AVX2 if enabled
+// with -mavx2, two SSE2 lanes otherwise). Misses probe until an empty slot:
+// they show the cost of h2 false positives and of the group width.
+std::uint64_t eq_calls = 0U;
+
+struct counting_eq {
+  bool operator()(std::uint64_t const a, std::uint64_t const b) const {
+    ++eq_calls;
+    return a == b;
+  }
+};
+
+template <typename Fn>
+double ns_per_lookup(std::size_t const n, Fn&& fn) {
+  auto const start = std::chrono::steady_clock::now();
+  fn();
+  auto const stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(stop - start).count() /
+         static_cast<double>(n);
+}
+
+std::vector<std::uint64_t> random_keys(std::size_t const n,
+                                       std::uint64_t const seed) {
+  auto rng = std::mt19937_64{seed};
+  auto keys = std::vector<std::uint64_t>(n);
+  for (auto& k : keys) {
+    k = rng();
+  }
+  return keys;
+}
+
+template <std::size_t Width>
+void bench_int(std::size_t const n) {
+  auto const keys = random_keys(n, 1U);
+  auto const misses = random_keys(n, 2U);
+
+  auto map = data::hash_map<std::uint64_t, std::uint64_t,
+                            cista::hashing<std::uint64_t>, counting_eq,
+                            Width>{};
+  for (auto const k : keys) {
+    map.emplace(k, k);
+  }
+
+  auto found = std::uint64_t{0U};
+  auto const hit_ns = ns_per_lookup(n, [&]() {
+    for (auto const k : keys) {
+      found += map.find(k)->second;
+    }
+  });
+  eq_calls = 0U;
+  auto const miss_ns = ns_per_lookup(n, [&]() {
+    for (auto const k : misses) {
+      found += map.find(k) == map.end() ? 0U : 1U;
+    }
+  });
+  std::printf(
+      "width %2zu, uint64 keys, %zu entries: hit %.1f ns, miss %.1f ns, "
+      "%.3f Eq calls per miss (%llu)\n",
+      Width, n, hit_ns, miss_ns,
+      static_cast<double>(eq_calls) / static_cast<double>(n),
+      static_cast<unsigned long long>(found));
+}
+
+template <std::size_t Width>
+void bench_string(std::size_t const n) {
+  auto const to_string = [](std::uint64_t const k) {
+    return std::string{"key/"} + std::to_string(k);
+  };
+  auto keys = std::vector<std::string>{};
+  auto misses = std::vector<std::string>{};
+  for (auto const k : random_keys(n, 1U)) {
+    keys.emplace_back(to_string(k));
+  }
+  for (auto const k : random_keys(n, 2U)) {
+    misses.emplace_back(to_string(k));
+  }
+
+  auto map = data::hash_map<data::string, std::uint64_t,
+                            cista::hashing<data::string>,
+                            cista::equal_to<data::string>, Width>{};
+  for (auto const& k : keys) {
+    map.emplace(data::string{k}, k.size());
+  }
+
+  auto found = std::uint64_t{0U};
+  auto const hit_ns = ns_per_lookup(n, [&]() {
+    for (auto const& k : keys) {
+      found += map.find(k)->second;
+    }
+  });
+  auto const miss_ns = ns_per_lookup(n, [&]() {
+    for (auto const& k : misses) {
+      found += map.find(k) == map.end() ? 0U : 1U;
+    }
+  });
+  std::printf(
+      "width %2zu, string keys, %zu entries: hit %.1f ns, miss %.1f ns "
+      "(%llu)\n",
+      Width, n, hit_ns, miss_ns, static_cast<unsigned long long>(found));
+}
+
+template <std::size_t Width>
+void bench_width(std::size_t const n) {
+  bench_int<Width>(n);
+  bench_int<Width>(n / 100U);
+  bench_string<Width>(n);
+  bench_string<Width>(n / 100U);
+}
+
+int main(int argc, char** argv) {
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{1'000'000U};
+  bench_width<8U>(n);
+  bench_width<16U>(n);
+  bench_width<32U>(n);
+}
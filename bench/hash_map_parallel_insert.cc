@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cista/containers/hash_map.h"
+#include "cista/containers/parallel_insert.h"
+#include "cista/containers/string.h"
+
+namespace data = cista::raw;
+
+// insert(first, last) vs. parallel_insert() (same layout) per thread count.
+template <typename Fn>
+double seconds(Fn&& fn) {
+  auto const start = std::chrono::steady_clock::now();
+  fn();
+  auto const stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+template <typename Map>
+void run(char const* name, std::vector<typename Map::entry_t> const& entries) {
+  auto const max_threads = std::max(1U, std::thread::hardware_concurrency());
+
+  auto m = Map{};
+  auto const t = seconds([&]() { m.insert(begin(entries), end(entries)); });
+  std::printf("%s, %zu entries: insert %.2f s\n", name, entries.size(), t);
+
+  for (auto n = 1U; n <= max_threads; n *= 2U) {
+    auto p = Map{};
+    auto const tp = seconds(
+        [&]() { cista::parallel_insert(p, begin(entries), end(entries), n); });
+    std::printf("  parallel_insert %2u threads: %.2f s (%zu)\n", n, tp,
+                static_cast<std::size_t>(p.size()));
+  }
+}
+
+int main(int argc, char** argv) {
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{16U * 1024U * 1024U};
+
+  using id_map = data::hash_map<std::uint64_t, std::uint32_t>;
+  auto rng = std::mt19937_64{1U};
+  auto ids = std::vector<id_map::entry_t>{};
+  ids.reserve(n);
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    ids.push_back({rng(), static_cast<std::uint32_t>(i)});
+  }
+  run<id_map>("uint64 -> uint32", ids);
+  ids = {};
+
+  using string_map = data::hash_map<data::string, std::uint32_t>;
+  auto strings = std::vector<string_map::entry_t>{};
+  strings.reserve(n / 4U);
+  for (auto i = std::size_t{0U}; i != n / 4U; ++i) {
+    strings.push_back({data::string{"https://example.org/resource/" +
+                                    std::to_string(rng())},
+                       static_cast<std::uint32_t>(i)});
+  }
+  run<string_map>("string -> uint32", strings);
+}
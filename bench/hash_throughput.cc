@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "cista/hash.h"
+#include "cista/segmented_hash.h"
+
+// Throughput of the configured hash function (select with -DCISTA_HASH=...)
+// and of the segmented hash (mode::WITH_SEGMENTED_INTEGRITY) per thread count.
+#if defined(CISTA_XXH3)
+constexpr auto const HASH_NAME = "XXH3";
+#elif defined(CISTA_WYHASH)
+constexpr auto const HASH_NAME = "WYHASH";
+#elif defined(CISTA_WYHASH_FASTEST)
+constexpr auto const HASH_NAME = "WYHASH_FASTEST";
+#else
+constexpr auto const HASH_NAME = "FNV1A";
+#endif
+
+template <typename Fn>
+double measure(Fn&& fn) {
+  auto const start = std::chrono::steady_clock::now();
+  fn();
+  auto const stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc, char** argv) {
+  auto const size = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                             : std::size_t{1024U * 1024U * 1024U};
+  auto const max_threads = std::max(1U, std::thread::hardware_concurrency());
+
+  auto data = std::vector<char>(size);
+  for (auto i = std::size_t{0U}; i != size; ++i) {
+    data[i] = static_cast<char>(i * 31U);
+  }
+  auto const view = std::string_view{data.data(), data.size()};
+  auto const gb = static_cast<double>(size) / 1e9;
+
+  auto h = cista::hash_t{};
+  auto const t = measure([&]() { h = cista::hash(view); });
+  std::printf("hash=%s size=%zu bytes sequential: %.3f s, %.2f GB/s\n",
+              HASH_NAME, size, t, gb / t);
+
+  for (auto n = 1U; n <= max_threads; n *= 2U) {
+    auto s = cista::hash_t{};
+    auto const ts = measure([&]() { s = cista::segmented_hash(view, n); });
+    std::printf(
+        "hash=%s segmented threads=%u: %.3f s, %.2f GB/s, %.2f GB/s/core\n",
+        HASH_NAME, n, ts, gb / ts, gb / ts / n);
+    h ^= s;
+  }
+  return h == 0U ? 1 : 0;
+}
@@ -0,0 +1,71 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "cista/load_file.h"
+#include "cista/serialization.h"
+
+namespace data = cista::offset;
+
+struct dataset {
+  data::vector<std::uint64_t> values_;
+};
+
+template <typename Fn>
+double measure(Fn&& fn) {
+  auto const start = std::chrono::steady_clock::now();
+  fn();
+  auto const stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+template <cista::mode Mode>
+void run(char const* name, dataset const& d) {
+  constexpr auto const FILENAME = "load_file.bin";
+  {
+    auto f = cista::file{FILENAME, "w+"};
+    cista::serialize<Mode>(f, d);
+  }
+
+  auto const content_time = measure([&]() {
+    auto b = cista::file{FILENAME, "r"}.content();
+    auto const e = cista::deserialize<dataset, Mode>(b);
+    if (e->values_.size() != d.values_.size()) {
+      std::abort();
+    }
+  });
+  auto const load_time = [&](std::size_t const num_threads) {
+    return measure([&]() {
+      auto o = cista::load_options{};
+      o.num_threads_ = num_threads;
+      auto const e = cista::load<dataset, Mode>(FILENAME, o);
+      if (e->values_.size() != d.values_.size()) {
+        std::abort();
+      }
+    });
+  };
+  auto const load_1 = load_time(1U);
+  auto const load_n = load_time(std::thread::hardware_concurrency());
+  std::remove(FILENAME);
+
+  std::printf(
+      "%-26s content+deserialize=%.3f s load(1 thread)=%.3f s "
+      "load(%u threads)=%.3f s\n",
+      name, content_time, load_1, std::thread::hardware_concurrency(), load_n);
+}
+
+int main(int argc, char** argv) {
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{200'000'000U};
+
+  auto d = dataset{};
+  d.values_.resize(n);
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    d.values_[i] = i;
+  }
+
+  run<cista::mode::NONE>("NONE", d);
+  run<cista::mode::WITH_INTEGRITY>("WITH_INTEGRITY", d);
+  run<cista::mode::WITH_SEGMENTED_INTEGRITY>("WITH_SEGMENTED_INTEGRITY", d);
+  run<cista::mode::WITH_BLOCK_INTEGRITY>("WITH_BLOCK_INTEGRITY", d);
+}
@@ -0,0 +1,72 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "cista/mapping_registry.h"
+#include "cista/mmap.h"
+#include "cista/serialization.h"
+
+namespace data = cista::offset;
+
+constexpr auto const MODE =
+    cista::mode::WITH_VERSION | cista::mode::WITH_INTEGRITY;
+
+struct dataset {
+  data::vector<std::uint64_t> values_;
+};
+
+template <typename Fn>
+double ms(Fn&& fn) {
+  auto const start = std::chrono::steady_clock::now();
+  fn();
+  auto const stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+int main(int argc, char** argv) {
+  constexpr auto const FILENAME = "mapping_registry_bench.bin";
+  auto const size_mb = argc > 1 ? std::atoi(argv[1]) : 64;
+  auto const components = argc > 2 ? std::atoi(argv[2]) : 16;
+
+  {
+    auto d = dataset{};
+    d.values_.resize(static_cast<std::size_t>(size_mb) * 1024U * 1024U /
+                     sizeof(std::uint64_t));
+    for (auto i = 0U; i != d.values_.size(); ++i) {
+      d.values_[i] = i;
+    }
+    auto f = cista::file{FILENAME, "w+"};
+    cista::serialize<MODE>(f, d);
+  }
+
+  auto sum = std::uint64_t{0U};
+
+  auto separate = std::vector<cista::mmap>{};
+  auto const separate_ms = ms([&]() {
+    for (auto i = 0; i != components; ++i) {
+      auto& m = separate.emplace_back(FILENAME, cista::mmap::protection::READ);
+      sum += cista::deserialize<dataset, MODE>(m)->values_.back();
+    }
+  });
+
+  auto shared = std::vector<std::shared_ptr<dataset const>>{};
+  auto r = cista::mapping_registry{};
+  auto const shared_ms = ms([&]() {
+    for (auto i = 0; i != components; ++i) {
+      sum += shared.emplace_back(r.open<dataset, MODE>(FILENAME))
+                 ->values_.back();
+    }
+  });
+
+  std::printf(
+      "%d components, %d MB file: separate mappings %.1f ms (%d mapped), "
+      "registry %.1f ms (%zu mapped) (%llu)\n",
+      components, size_mb, separate_ms, components, shared_ms, r.size(),
+      static_cast<unsigned long long>(sum));
+
+  separate.clear();
+  shared.clear();
+  std::remove(FILENAME);
+}
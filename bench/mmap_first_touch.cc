@@ -0,0 +1,84 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "cista/advise.h"
+#include "cista/mmap.h"
+#include "cista/serialization.h"
+
+namespace data = cista::offset;
+
+constexpr auto const FILENAME = "mmap_first_touch.bin";
+constexpr auto const MODE = cista::mode::CAST;
+
+using lookup_t = data::hash_map<std::uint64_t, std::uint64_t>;
+
+void write_file(std::size_t const n) {
+  auto m = lookup_t{};
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    m.emplace(i, i);
+  }
+  auto out = cista::buf<cista::mmap>{cista::mmap{FILENAME}};
+  cista::serialize<MODE>(out, m);
+}
+
+// Drops the (clean) pages of the file from the page cache.
+void evict() {
+  auto const fd = ::open(FILENAME, O_RDONLY);
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+}
+
+template <typename Fn>
+void run(char const* name, std::size_t const n, cista::mmap::prefault p,
+         cista::advice const a, Fn&& prepare) {
+  evict();
+
+  auto const start = std::chrono::steady_clock::now();
+  auto m = cista::mmap{FILENAME, a, p};
+  auto const lookup = cista::deserialize<lookup_t, MODE>(m);
+  prepare(*lookup);
+  auto const ready = std::chrono::steady_clock::now();
+
+  auto rng = std::mt19937_64{42U};
+  auto dist = std::uniform_int_distribution<std::uint64_t>{0U, n - 1U};
+  auto worst = 0.0;
+  auto sum = std::uint64_t{0U};
+  for (auto i = 0U; i != 10'000U; ++i) {
+    auto const q = std::chrono::steady_clock::now();
+    sum += lookup->at(dist(rng));
+    worst = std::max(
+        worst,
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - q)
+            .count());
+  }
+  auto const stop = std::chrono::steady_clock::now();
+
+  std::printf("%-26s setup=%.3f s 10k lookups=%.3f s worst=%.1f us (%llu)\n",
+              name, std::chrono::duration<double>(ready - start).count(),
+              std::chrono::duration<double>(stop - ready).count(),
+              worst * 1e6, static_cast<unsigned long long>(sum));
+}
+
+int main(int argc, char** argv) {
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{20'000'000U};
+  write_file(n);
+
+  auto const nothing = [](lookup_t const&) {};
+  run("NORMAL", n, cista::mmap::prefault::NONE, cista::advice::NORMAL,
+      nothing);
+  run("RANDOM", n, cista::mmap::prefault::NONE, cista::advice::RANDOM,
+      nothing);
+  run("POPULATE", n, cista::mmap::prefault::POPULATE, cista::advice::NORMAL,
+      nothing);
+  run("RANDOM + advise(WILLNEED)", n, cista::mmap::prefault::NONE,
+      cista::advice::RANDOM, [](lookup_t const& l) {
+        cista::advise(l, cista::advice::WILLNEED);
+      });
+  std::remove(FILENAME);
+}
@@ -0,0 +1,47 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "cista/mmap.h"
+#include "cista/serialization.h"
+
+namespace data = cista::offset;
+
+struct dataset {
+  data::vector<data::vector<std::uint32_t>> groups_;
+};
+
+template <typename Fn>
+double measure(Fn&& fn) {
+  auto const start = std::chrono::steady_clock::now();
+  fn();
+  auto const stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc, char** argv) {
+  constexpr auto const FILENAME = "mmap_growth.bin";
+
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{10'000'000U};
+
+  auto d = dataset{};
+  d.groups_.resize(n);
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    d.groups_[i] = {static_cast<std::uint32_t>(i), 1U, 2U};
+  }
+
+  auto const run = [&](cista::mmap::durability const durability) {
+    return measure([&]() {
+      auto m = cista::buf<cista::mmap>{
+          cista::mmap{FILENAME, cista::mmap::protection::WRITE, durability}};
+      cista::serialize(m, d);
+    });
+  };
+  auto const sync_time = run(cista::mmap::durability::SYNC_ON_CLOSE);
+  auto const no_sync_time = run(cista::mmap::durability::NONE);
+  std::remove(FILENAME);
+
+  std::printf("elements=%zu sync_on_close=%.3f s no_sync=%.3f s\n", n,
+              sync_time, no_sync_time);
+}
@@ -0,0 +1,71 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "cista/mmap.h"
+#include "cista/serialization.h"
+
+namespace raw = cista::raw;
+
+struct dataset {
+  raw::vector<std::uint64_t> values_;
+  raw::vector<raw::string> names_;
+};
+
+// Private dirty memory of this process in kB (Linux).
+std::size_t private_dirty_kb() {
+  auto in = std::ifstream{"/proc/self/smaps_rollup"};
+  auto line = std::string{};
+  while (std::getline(in, line)) {
+    if (line.rfind("Private_Dirty:", 0U) == 0U) {
+      return std::stoul(line.substr(14U));
+    }
+  }
+  return 0U;
+}
+
+template <typename Fn>
+double measure(Fn&& fn) {
+  auto const start = std::chrono::steady_clock::now();
+  fn();
+  auto const stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc, char** argv) {
+  constexpr auto const FILENAME = "mmap_private.bin";
+
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{100'000'000U};
+  {
+    auto d = dataset{};
+    d.values_.resize(n);
+    for (auto i = 0U; i != 1'000U; ++i) {
+      d.names_.emplace_back("name that does not fit into the short string");
+    }
+    auto m = cista::buf<cista::mmap>{cista::mmap{FILENAME}};
+    cista::serialize(m, d);
+  }
+
+  auto const file_size = cista::file{FILENAME, "r"}.size();
+  {
+    auto const dirty_before = private_dirty_kb();
+    auto m = cista::mmap{FILENAME, cista::mmap::protection::PRIVATE};
+    auto const t = measure([&]() { cista::deserialize<dataset>(m); });
+    std::printf("PRIVATE mapping: %.3f s, copied %zu kB of %zu kB\n", t,
+                private_dirty_kb() - dirty_before, file_size / 1024U);
+  }
+  {
+    auto const dirty_before = private_dirty_kb();
+    auto b = cista::buffer{};
+    auto const t = measure([&]() {
+      b = cista::file{FILENAME, "r"}.content();
+      cista::deserialize<dataset>(b);
+    });
+    std::printf("content() copy:  %.3f s, copied %zu kB of %zu kB\n", t,
+                private_dirty_kb() - dirty_before, file_size / 1024U);
+  }
+  std::remove(FILENAME);
+}
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "cista/serialization.h"
+
+namespace data = cista::offset;
+
+struct position {
+  double lat_;
+  double lng_;
+  std::uint32_t level_;
+};
+
+struct inner {
+  position pos_;
+  std::uint64_t flags_;
+  data::string label_;
+  std::uint16_t rank_;
+};
+
+struct outer {
+  std::uint32_t id_;
+  inner a_;
+  inner b_;
+  position center_;
+  data::vector<std::uint32_t> refs_;
+};
+
+int main(int argc, char** argv) {
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{5'000'000U};
+
+  auto v = data::vector<outer>{};
+  v.resize(n);
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    v[i].id_ = static_cast<std::uint32_t>(i);
+    v[i].refs_ = {1U, 2U};
+  }
+
+  auto const serialize_start = std::chrono::steady_clock::now();
+  auto b = cista::serialize(v);
+  auto const serialize_stop = std::chrono::steady_clock::now();
+
+  auto const deserialize_start = std::chrono::steady_clock::now();
+  auto const d = cista::deserialize<data::vector<outer>>(b);
+  auto const deserialize_stop = std::chrono::steady_clock::now();
+
+  std::printf(
+      "elements=%zu size=%zu bytes serialize=%.3f s deserialize=%.3f s\n",
+      static_cast<std::size_t>(d->size()), b.size(),
+      std::chrono::duration<double>(serialize_stop - serialize_start).count(),
+      std::chrono::duration<double>(deserialize_stop - deserialize_start)
+          .count());
+}
@@ -0,0 +1,45 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "cista/serialization.h"
+
+namespace data = cista::offset;
+
+struct point {
+  std::uint32_t x_;
+  std::uint32_t y_;
+  double weight_;
+};
+
+struct columns {
+  data::vector<std::uint32_t> ids_;
+  data::vector<point> points_;
+};
+
+int main(int argc, char** argv) {
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{100'000'000U};
+
+  auto c = columns{};
+  c.ids_.resize(n);
+  c.points_.resize(n / 4U);
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    c.ids_[i] = static_cast<std::uint32_t>(i);
+  }
+
+  auto const start = std::chrono::steady_clock::now();
+  auto b = cista::serialize(c);
+  auto const stop = std::chrono::steady_clock::now();
+
+  auto const deserialize_start = std::chrono::steady_clock::now();
+  auto const d = cista::deserialize<columns>(b);
+  auto const deserialize_stop = std::chrono::steady_clock::now();
+
+  std::printf(
+      "elements=%zu size=%zu bytes serialize=%.3f s deserialize=%.3f s\n", n,
+      b.size(), std::chrono::duration<double>(stop - start).count(),
+      std::chrono::duration<double>(deserialize_stop - deserialize_start)
+          .count());
+  return d->ids_.size() == n ? 0 : 1;
+}
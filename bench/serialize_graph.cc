@@ -0,0 +1,75 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "cista/serialization.h"
+
+namespace data = cista::offset;
+
+struct node;
+
+using node_id_t = std::uint32_t;
+
+struct edge {
+  data::ptr<node> from_;
+  data::ptr<node> to_;
+};
+
+struct node {
+  node_id_t id_{0U};
+  node_id_t fill_{0U};
+  data::vector<data::ptr<edge>> edges_;
+  cista::indexed<data::string> name_;
+};
+
+struct graph {
+  data::indexed_vector<node> nodes_;
+  data::indexed_vector<edge> edges_;
+  data::vector<data::ptr<data::string>> node_names_;
+};
+
+graph make_graph(std::size_t const n) {
+  auto g = graph{};
+  g.nodes_.resize(n);
+  g.edges_.resize(2U * n);
+  g.node_names_.resize(n);
+
+  auto rng = std::uint64_t{42U};
+  auto const next_random = [&]() {
+    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    return static_cast<std::size_t>(rng >> 33U) % n;
+  };
+
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    auto& nd = g.nodes_[i];
+    nd.id_ = static_cast<node_id_t>(i);
+    nd.name_ = data::string{"node"};
+    g.node_names_[i] = &nd.name_;
+
+    auto& next = g.edges_[2U * i];
+    next.from_ = &nd;
+    next.to_ = &g.nodes_[(i + 1U) % n];
+
+    auto& random = g.edges_[2U * i + 1U];
+    random.from_ = &nd;
+    random.to_ = &g.nodes_[next_random()];
+
+    nd.edges_ = {&next, &random};
+  }
+
+  return g;
+}
+
+int main(int argc, char** argv) {
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{10'000'000U};
+
+  auto const g = make_graph(n);
+
+  auto const start = std::chrono::steady_clock::now();
+  auto const b = cista::serialize(g);
+  auto const stop = std::chrono::steady_clock::now();
+
+  std::printf("nodes=%zu size=%zu bytes serialize=%.3f s\n", n, b.size(),
+              std::chrono::duration<double>(stop - start).count());
+}
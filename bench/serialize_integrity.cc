@@ -0,0 +1,56 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "cista/serialization.h"
+
+namespace data = cista::offset;
+
+struct columns {
+  data::vector<std::uint32_t> ids_;
+  data::vector<data::vector<std::uint64_t>> groups_;
+};
+
+template <cista::mode Mode, typename Target>
+double measure(Target& t, columns& c) {
+  auto const start = std::chrono::steady_clock::now();
+  cista::serialize<Mode>(t, c);
+  auto const stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+template <cista::mode Mode>
+void run(char const* name, columns& c) {
+  auto b = cista::buf{};
+  auto const buf_time = measure<Mode>(b, c);
+
+  auto file_time = 0.0;
+  {
+    auto f = cista::file{"serialize_integrity.bin", "w+"};
+    file_time = measure<Mode>(f, c);
+  }
+  std::remove("serialize_integrity.bin");
+
+  std::printf("%-24s size=%zu bytes buf=%.3f s file=%.3f s\n", name, b.size(),
+              buf_time, file_time);
+}
+
+int main(int argc, char** argv) {
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{50'000'000U};
+
+  auto c = columns{};
+  c.ids_.resize(n);
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    c.ids_[i] = static_cast<std::uint32_t>(i);
+  }
+  c.groups_.resize(n / 1000U);
+  for (auto& g : c.groups_) {
+    g.resize(100U);
+  }
+
+  run<cista::mode::NONE>("NONE", c);
+  run<cista::mode::WITH_INTEGRITY>("WITH_INTEGRITY", c);
+  run<cista::mode::WITH_SEGMENTED_INTEGRITY>("WITH_SEGMENTED_INTEGRITY", c);
+  run<cista::mode::WITH_BLOCK_INTEGRITY>("WITH_BLOCK_INTEGRITY", c);
+}
@@ -0,0 +1,60 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "cista/serialize_parallel.h"
+
+namespace data = cista::offset;
+
+struct entry {
+  std::uint32_t id_;
+  data::string name_;
+};
+
+struct dataset {
+  data::vecvec<std::uint32_t, std::uint32_t> a_;
+  data::vecvec<std::uint32_t, std::uint32_t> b_;
+  data::vector<entry> entries_;
+  data::hash_map<std::uint32_t, data::vector<std::uint32_t>> map_;
+};
+
+dataset make_dataset(std::size_t const n) {
+  auto d = dataset{};
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    auto const x = static_cast<std::uint32_t>(i);
+    d.a_.emplace_back(std::initializer_list<std::uint32_t>{x, x + 1U});
+    d.b_.emplace_back(std::initializer_list<std::uint32_t>{x, x * 2U, x});
+    d.entries_.emplace_back(entry{x, data::string{"a name not short enough"}});
+    d.map_[x] = {x, x};
+  }
+  return d;
+}
+
+template <typename Fn>
+double measure(Fn&& fn) {
+  auto const start = std::chrono::steady_clock::now();
+  fn();
+  auto const stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc, char** argv) {
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{2'000'000U};
+  auto const threads = argc > 2
+                           ? static_cast<std::size_t>(std::atoll(argv[2]))
+                           : std::size_t{std::thread::hardware_concurrency()};
+
+  auto d = make_dataset(n);
+
+  auto sequential = cista::buf{};
+  auto const t_sequential = measure([&]() { cista::serialize(sequential, d); });
+
+  auto parallel = cista::buf{};
+  auto const t_parallel =
+      measure([&]() { cista::serialize_parallel(parallel, d, threads); });
+
+  std::printf("n=%zu threads=%zu size=%zu sequential=%.3f s parallel=%.3f s\n",
+              n, threads, parallel.size(), t_sequential, t_parallel);
+}
@@ -0,0 +1,63 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "cista/serialization.h"
+#include "cista/targets/uring_file.h"
+
+namespace data = cista::offset;
+
+struct dataset {
+  data::vector<data::vector<std::uint32_t>> groups_;
+  data::vector<data::string> names_;
+};
+
+template <typename Fn>
+double measure(Fn&& fn) {
+  auto const start = std::chrono::steady_clock::now();
+  fn();
+  auto const stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc, char** argv) {
+  constexpr auto const FILENAME = "serialize_uring_file.bin";
+  constexpr auto const MODE = cista::mode::WITH_BLOCK_INTEGRITY;
+  constexpr auto const BUFFER_SIZE = std::size_t{1024U * 1024U};
+
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{2'000'000U};
+
+  auto d = dataset{};
+  d.groups_.resize(n);
+  d.names_.resize(n);
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    d.groups_[i] = {static_cast<std::uint32_t>(i), 1U, 2U};
+    d.names_[i] = "name that does not fit into the short string";
+  }
+
+  auto const file_time = measure([&]() {
+    auto f = cista::file{FILENAME, "w+"};
+    cista::serialize<MODE>(f, d);
+  });
+  auto const buffered_file_time = measure([&]() {
+    auto f = cista::buffered_file{FILENAME, BUFFER_SIZE};
+    cista::serialize<MODE>(f, d);
+  });
+  auto const uring = [&](cista::uring_writer::options const& o) {
+    return measure([&]() {
+      auto f = cista::uring_file{FILENAME, BUFFER_SIZE,
+                                 cista::uring_file::durability::SYNC_ON_CLOSE,
+                                 o};
+      cista::serialize<MODE>(f, d);
+    });
+  };
+  auto const uring_time = uring({4U, false, true});
+  auto const uring_direct_time = uring({4U, true, true});
+  std::remove(FILENAME);
+
+  std::printf(
+      "elements=%zu file=%.3f s buffered_file=%.3f s "
+      "uring_file+fdatasync=%.3f s uring_file+O_DIRECT+fdatasync=%.3f s\n",
+      n, file_time, buffered_file_time, uring_time, uring_direct_time);
+}
@@ -0,0 +1,60 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "cista/mmap.h"
+#include "cista/serialization.h"
+#include "cista/shared_memory.h"
+
+namespace data = cista::offset;
+
+struct dataset {
+  data::vector<data::vector<std::uint32_t>> groups_;
+};
+
+template <typename Fn>
+double measure(Fn&& fn) {
+  auto const start = std::chrono::steady_clock::now();
+  fn();
+  auto const stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc, char** argv) {
+  constexpr auto const FILENAME = "shared_memory_handoff.bin";
+
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{10'000'000U};
+
+  auto d = dataset{};
+  d.groups_.resize(n);
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    d.groups_[i] = {static_cast<std::uint32_t>(i), 1U, 2U};
+  }
+
+  auto sum = std::size_t{0U};
+  auto const file_time = measure([&]() {
+    {
+      auto out = cista::buf<cista::mmap>{cista::mmap{FILENAME}};
+      cista::serialize(out, d);
+    }
+    auto in = cista::mmap{FILENAME, cista::mmap::protection::READ};
+    sum += cista::deserialize<dataset>(in)->groups_.size();
+  });
+  std::remove(FILENAME);
+
+  auto const memfd_time = measure([&]() {
+    auto out = cista::buf<cista::memfd>{cista::memfd{"handoff"}};
+    cista::serialize(out, d);
+    out.buf_.seal();
+    auto in = cista::memfd_view{out.buf_.fd()};
+    sum += in.is_sealed()
+               ? cista::deserialize<dataset, cista::mode::CAST>(in)
+                     ->groups_.size()
+               : cista::deserialize<dataset>(in)->groups_.size();
+  });
+
+  std::printf(
+      "elements=%zu file+mmap+checked=%.3f s memfd+seal+cast=%.3f s (%zu)\n",
+      n, file_time, memfd_time, sum);
+}
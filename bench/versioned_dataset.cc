@@ -0,0 +1,68 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+
+#include "cista/serialization.h"
+#include "cista/versioned_dataset.h"
+
+namespace data = cista::offset;
+
+struct dataset {
+  data::vector<std::uint64_t> values_;
+};
+
+cista::wrapped<dataset> make_version(std::uint64_t const v) {
+  auto d = dataset{};
+  d.values_.resize(1'000U, v);
+  auto b = cista::serialize(d);
+  auto const el = cista::deserialize<dataset>(b);
+  return cista::wrapped<dataset>{std::move(b), el};
+}
+
+template <typename Fn>
+double ns_per_op(std::size_t const n, Fn&& fn) {
+  auto const start = std::chrono::steady_clock::now();
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    fn(i);
+  }
+  auto const stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(stop - start).count() /
+         static_cast<double>(n);
+}
+
+int main(int argc, char** argv) {
+  auto const n = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1]))
+                          : std::size_t{50'000'000U};
+
+  auto sum = std::uint64_t{0U};
+
+  auto versioned = cista::versioned_dataset<dataset>{};
+  versioned.publish(make_version(1U));
+  auto const versioned_ns = ns_per_op(n, [&](std::size_t const i) {
+    auto const s = versioned.acquire();
+    sum += s->values_[i % 1'000U];
+  });
+
+  auto mutex = std::mutex{};
+  auto current = std::make_shared<cista::wrapped<dataset>>(make_version(1U));
+  auto const mutex_ns = ns_per_op(n, [&](std::size_t const i) {
+    auto s = std::shared_ptr<cista::wrapped<dataset>>{};
+    {
+      auto const lock = std::lock_guard{mutex};
+      s = current;
+    }
+    sum += (*s)->values_[i % 1'000U];
+  });
+
+  auto const atomic_ns = ns_per_op(n, [&](std::size_t const i) {
+    auto const s = std::atomic_load(&current);
+    sum += (*s)->values_[i % 1'000U];
+  });
+
+  std::printf(
+      "snapshot + lookup: versioned_dataset=%.1f ns mutex+shared_ptr=%.1f ns "
+      "atomic_load(shared_ptr)=%.1f ns (%llu)\n",
+      versioned_ns, mutex_ns, atomic_ns, static_cast<unsigned long long>(sum));
+}
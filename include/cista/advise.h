@@ -0,0 +1,85 @@
+#pragma once
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <cinttypes>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "cista/containers/ptr.h"
+
+namespace cista {
+
+// Access pattern hints for memory backed by a file mapping (madvise).
+//   - SEQUENTIAL / RANDOM: read-ahead policy for page faults
+//   - WILLNEED: start reading the pages in the background
+//   - HUGEPAGE: back the range with transparent huge pages (anonymous
+//     memory, tmpfs and - depending on the kernel - read-only files)
+enum class advice { NORMAL, SEQUENTIAL, RANDOM, WILLNEED, HUGEPAGE };
+
+// Applies `a` to all pages overlapping [ptr, ptr + size).
+// Returns false if the hint is not supported (e.g. on Windows).
+inline bool advise(void const* ptr, std::size_t const size, advice const a) {
+#ifdef _WIN32
+  (void)ptr;
+  (void)size;
+  (void)a;
+  return false;
+#else
+  if (size == 0U) {
+    return true;
+  }
+
+  auto flag = MADV_NORMAL;
+  switch (a) {
+    case advice::NORMAL: break;
+    case advice::SEQUENTIAL: flag = MADV_SEQUENTIAL; break;
+    case advice::RANDOM: flag = MADV_RANDOM; break;
+    case advice::WILLNEED: flag = MADV_WILLNEED; break;
+#ifdef MADV_HUGEPAGE
+    case advice::HUGEPAGE: flag = MADV_HUGEPAGE; break;
+#else
+    case advice::HUGEPAGE: return false;
+#endif
+  }
+
+  auto const page_size = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+  auto const begin = reinterpret_cast<std::uintptr_t>(ptr) & ~(page_size - 1U);
+  auto const end = reinterpret_cast<std::uintptr_t>(ptr) + size;
+  return ::madvise(reinterpret_cast<void*>(begin), end - begin, flag) == 0;
+#endif
+}
+
+// Applies `a` to the storage of a (deserialized) container, e.g.
+//   cista::advise(d->values_, cista::advice::WILLNEED);
+// before the first access to avoid page faults on the request path.
+template <typename Container>
+auto advise(Container const& c, advice const a)
+    -> decltype(c.data(), c.size(), bool{}) {
+  return advise(c.data(), c.size() * sizeof(*c.data()), a);
+}
+
+template <typename T, template <typename> typename Ptr, typename GetKey,
+          typename GetValue, typename Hash, typename Eq, std::size_t Width>
+struct hash_storage;
+
+// Entries and ctrl bytes of hash maps and sets (one allocation).
+template <typename T, template <typename> typename Ptr, typename GetKey,
+          typename GetValue, typename Hash, typename Eq, std::size_t Width>
+bool advise(hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq, Width> const& h,
+            advice const a) {
+  if (h.capacity_ == 0U) {
+    return true;
+  }
+  auto const entries =
+      reinterpret_cast<std::uint8_t const*>(ptr_cast(h.entries_));
+  auto const ctrl_end = reinterpret_cast<std::uint8_t const*>(
+      ptr_cast(h.ctrl_) + h.capacity_ + 1U + h.WIDTH);
+  return advise(entries, static_cast<std::size_t>(ctrl_end - entries), a);
+}
+
+}  // namespace cista
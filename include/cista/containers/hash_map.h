@@ -25,16 +25,16 @@ struct get_second {
 
 namespace raw {
 template <typename Key, typename Value, typename Hash = hashing<Key>,
-          typename Eq = equal_to<Key>>
-using hash_map =
-    hash_storage<pair<Key, Value>, ptr, get_first, get_second, Hash, Eq>;
+          typename Eq = equal_to<Key>, std::size_t Width = 8U>
+using hash_map = hash_storage<pair<Key, Value>, ptr, get_first, get_second,
+                              Hash, Eq, Width>;
 }  // namespace raw
 
 namespace offset {
 template <typename Key, typename Value, typename Hash = hashing<Key>,
-          typename Eq = equal_to<Key>>
-using hash_map =
-    hash_storage<pair<Key, Value>, ptr, get_first, get_second, Hash, Eq>;
+          typename Eq = equal_to<Key>, std::size_t Width = 8U>
+using hash_map = hash_storage<pair<Key, Value>, ptr, get_first, get_second,
+                              Hash, Eq, Width>;
 }  // namespace offset
 
 }  // namespace cista
@@ -16,13 +16,15 @@ struct identity {
 };
 
 namespace raw {
-template <typename T, typename Hash = hashing<T>, typename Eq = equal_to<T>>
-using hash_set = hash_storage<T, ptr, identity, identity, Hash, Eq>;
+template <typename T, typename Hash = hashing<T>, typename Eq = equal_to<T>,
+          std::size_t Width = 8U>
+using hash_set = hash_storage<T, ptr, identity, identity, Hash, Eq, Width>;
 }  // namespace raw
 
 namespace offset {
-template <typename T, typename Hash = hashing<T>, typename Eq = equal_to<T>>
-using hash_set = hash_storage<T, ptr, identity, identity, Hash, Eq>;
+template <typename T, typename Hash = hashing<T>, typename Eq = equal_to<T>,
+          std::size_t Width = 8U>
+using hash_set = hash_storage<T, ptr, identity, identity, Hash, Eq, Width>;
 }  // namespace offset
 
 }  // namespace cista
@@ -1,5 +1,23 @@
 #pragma once
 
+#include "cista/endian/detection.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>  // _mm_prefetch
+#endif
+
+#if !defined(CISTA_NO_SIMD) &&                        \
+    (defined(__SSE2__) || defined(_M_X64) ||          \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define CISTA_HASH_STORAGE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if !defined(CISTA_NO_SIMD) && defined(__AVX2__)
+#define CISTA_HASH_STORAGE_AVX2
+#include <immintrin.h>
+#endif
+
 #include <cinttypes>
 #include <cstring>
 #include <functional>
@@ -16,6 +34,91 @@
 
 namespace cista {
 
+namespace detail {
+
+// Lanes of the 16 / 32 wide hash_storage groups. match() returns one bit per
+// byte equal to h, match_empty_or_deleted() one bit per byte < -1 (EMPTY =
+// -128 or DELETED = -2).
+struct swar_lane {
+  using type = std::uint64_t;
+  static constexpr auto const WIDTH = std::size_t{8U};
+  static constexpr auto const MSBS = 0x8080808080808080ULL;
+  static constexpr auto const LSBS = 0x0101010101010101ULL;
+  static constexpr auto const LOWS = 0x7F7F7F7F7F7F7F7FULL;
+
+  static type load(void const* pos) noexcept {
+    auto l = type{};
+    std::memcpy(&l, pos, WIDTH);
+#if defined(CISTA_BIG_ENDIAN)
+    l = endian_swap(l);
+#endif
+    return l;
+  }
+  static std::uint32_t match(type const l, std::uint8_t const h) noexcept {
+    auto const x = l ^ (LSBS * h);
+    return compress(~(((x & LOWS) + LOWS) | x | LOWS));
+  }
+  static std::uint32_t match_empty_or_deleted(type const l) noexcept {
+    return compress((l & (~l << 7U)) & MSBS);
+  }
+  // Gathers the high bit of each byte into the low 8 bits.
+  static constexpr std::uint32_t compress(type const m) noexcept {
+    return static_cast<std::uint32_t>(((m >> 7U) * 0x0102040810204080ULL) >>
+                                      56U);
+  }
+};
+
+#if defined(CISTA_HASH_STORAGE_SSE2)
+struct sse2_lane {
+  using type = __m128i;
+  static constexpr auto const WIDTH = std::size_t{16U};
+
+  static type load(void const* pos) noexcept {
+    return _mm_loadu_si128(static_cast<__m128i const*>(pos));
+  }
+  static std::uint32_t match(type const l, std::uint8_t const h) noexcept {
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(l, _mm_set1_epi8(static_cast<char>(h)))));
+  }
+  static std::uint32_t match_empty_or_deleted(type const l) noexcept {
+    return static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), l)));
+  }
+};
+#endif
+
+#if defined(CISTA_HASH_STORAGE_AVX2)
+struct avx2_lane {
+  using type = __m256i;
+  static constexpr auto const WIDTH = std::size_t{32U};
+
+  static type load(void const* pos) noexcept {
+    return _mm256_loadu_si256(static_cast<__m256i const*>(pos));
+  }
+  static std::uint32_t match(type const l, std::uint8_t const h) noexcept {
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(l, _mm256_set1_epi8(static_cast<char>(h)))));
+  }
+  static std::uint32_t match_empty_or_deleted(type const l) noexcept {
+    return static_cast<std::uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(-1), l)));
+  }
+};
+#endif
+
+#if defined(CISTA_HASH_STORAGE_AVX2)
+template <std::size_t Width>
+using group_lane = std::conditional_t<Width == 32U, avx2_lane, sse2_lane>;
+#elif defined(CISTA_HASH_STORAGE_SSE2)
+template <std::size_t>
+using group_lane = sse2_lane;
+#else
+template <std::size_t>
+using group_lane = swar_lane;
+#endif
+
+}  // namespace detail
+
 // This class is a generic hash-based container.
 // It can be used e.g. as hash set or hash map.
 //   - hash map: `T` = `std::pair<Key, Value>`, GetKey = `return entry.first;`
@@ -27,14 +130,29 @@ namespace cista {
 // Original implementation:
 // https://github.com/abseil/abseil-cpp/blob/master/absl/container/internal/raw_hash_set.h
 //
+// Groups are Width ctrl bytes wide. The serialized ctrl layout and the
+// probe sequence depend on it, so Width is part of the type (and of the
+// type hash if it is not 8): a file written with one width is rejected by
+// mode::WITH_VERSION when read with another one.
+//   - Width = 8 (default, the layout of all existing files): SWAR group,
+//     one bit per slot in the high bit of each byte.
+//   - Width = 16 / 32: one bit per slot. Matched with SSE2 (16 bytes per
+//     instruction) or AVX2 (32 bytes), with SWAR on 8 byte lanes otherwise.
+//     The CPU features only select the matching code, never the layout.
+// All groups match exactly: no false positive matches, Eq is only called
+// for entries with equal h2.
+//
 // Missing features of this implemenation compared to the original:
-//   - SSE to speedup the lookup in the ctrl data structure
 //   - sanitizer support (Sanitizer[Un]PoisonMemoryRegion)
 //   - overloads (conveniance as well to reduce copying) in the interface
 //   - allocator support
 template <typename T, template <typename> typename Ptr, typename GetKey,
-          typename GetValue, typename Hash, typename Eq>
+          typename GetValue, typename Hash, typename Eq,
+          std::size_t Width = 8U>
 struct hash_storage {
+  static_assert(Width == 8U || Width == 16U || Width == 32U,
+                "hash_storage: group width has to be 8, 16 or 32");
+
   using entry_t = T;
   using difference_type = ptrdiff_t;
   using size_type = hash_t;
@@ -43,8 +161,9 @@ struct hash_storage {
   using mapped_type =
       decay_t<decltype(std::declval<GetValue>().operator()(std::declval<T>()))>;
   using group_t = std::uint64_t;
+  using mask_t = std::conditional_t<Width == 8U, std::uint64_t, std::uint32_t>;
   using h2_t = std::uint8_t;
-  static constexpr size_type const WIDTH = 8U;
+  static constexpr size_type const WIDTH = Width;
   static constexpr std::size_t const ALIGNMENT = alignof(T);
 
   template <typename Key>
@@ -81,9 +200,9 @@ struct hash_storage {
   };
 
   struct bit_mask {
-    static constexpr auto const SHIFT = 3U;
+    static constexpr auto const SHIFT = WIDTH == 8U ? 3U : 0U;
 
-    constexpr explicit bit_mask(group_t const mask) noexcept : mask_{mask} {}
+    constexpr explicit bit_mask(mask_t const mask) noexcept : mask_{mask} {}
 
     bit_mask& operator++() noexcept {
       mask_ &= (mask_ - 1U);
@@ -102,32 +221,35 @@ struct hash_storage {
     }
 
     size_type leading_zeros() const noexcept {
-      constexpr int total_significant_bits = 8 << SHIFT;
-      constexpr int extra_bits = sizeof(group_t) * 8 - total_significant_bits;
-      return ::cista::leading_zeros(mask_ << extra_bits) >> SHIFT;
+      constexpr int total_significant_bits = WIDTH << SHIFT;
+      constexpr int extra_bits = sizeof(mask_t) * 8 - total_significant_bits;
+      return ::cista::leading_zeros(static_cast<mask_t>(mask_ << extra_bits)) >>
+             SHIFT;
     }
 
     friend bool operator!=(bit_mask const& a, bit_mask const& b) noexcept {
       return a.mask_ != b.mask_;
     }
 
-    group_t mask_;
+    mask_t mask_;
   };
 
-  struct group {
+  struct swar_group {
     static constexpr auto MSBS = 0x8080808080808080ULL;
     static constexpr auto LSBS = 0x0101010101010101ULL;
     static constexpr auto GAPS = 0x00FEFEFEFEFEFEFEULL;
+    static constexpr auto LOWS = 0x7F7F7F7F7F7F7F7FULL;
 
-    explicit group(ctrl_t const* pos) noexcept {
+    explicit swar_group(ctrl_t const* pos) noexcept {
       std::memcpy(&ctrl_, pos, WIDTH);
 #if defined(CISTA_BIG_ENDIAN)
       ctrl_ = endian_swap(ctrl_);
 #endif
     }
     bit_mask match(h2_t const hash) const noexcept {
+      // Exact zero byte test: no borrow from one byte into the next.
       auto const x = ctrl_ ^ (LSBS * hash);
-      return bit_mask{(x - LSBS) & ~x & MSBS};
+      return bit_mask{~(((x & LOWS) + LOWS) | x | LOWS)};
     }
     bit_mask match_empty() const noexcept {
       return bit_mask{(ctrl_ & (~ctrl_ << 6U)) & MSBS};
@@ -142,6 +264,55 @@ struct hash_storage {
     group_t ctrl_;
   };
 
+  // WIDTH 16 / 32: one mask bit per ctrl byte, matched in lanes of 32
+  // (AVX2), 16 (SSE2) or 8 (SWAR) bytes.
+  struct simd_group {
+    using lane = detail::group_lane<WIDTH>;
+    static constexpr auto const LANES = WIDTH / lane::WIDTH;
+
+    explicit simd_group(ctrl_t const* pos) noexcept {
+      for (auto i = std::size_t{0U}; i != LANES; ++i) {
+        lanes_[i] = lane::load(pos + i * lane::WIDTH);
+      }
+    }
+
+    bit_mask match(h2_t const hash) const noexcept {
+      return collect([&](auto const& l) { return lane::match(l, hash); });
+    }
+
+    bit_mask match_empty() const noexcept {
+      return collect([](auto const& l) {
+        return lane::match(l, static_cast<std::uint8_t>(EMPTY));
+      });
+    }
+
+    bit_mask match_empty_or_deleted() const noexcept {
+      return collect(
+          [](auto const& l) { return lane::match_empty_or_deleted(l); });
+    }
+
+    std::size_t count_leading_empty_or_deleted() const noexcept {
+      auto const not_empty_or_deleted =
+          static_cast<mask_t>(~match_empty_or_deleted().mask_);
+      return ::cista::trailing_zeros(std::uint64_t{not_empty_or_deleted} |
+                                     (std::uint64_t{1U} << WIDTH));
+    }
+
+  private:
+    template <typename Fn>
+    bit_mask collect(Fn&& lane_mask) const noexcept {
+      auto mask = mask_t{0U};
+      for (auto i = std::size_t{0U}; i != LANES; ++i) {
+        mask |= static_cast<mask_t>(lane_mask(lanes_[i]) << (i * lane::WIDTH));
+      }
+      return bit_mask{mask};
+    }
+
+    typename lane::type lanes_[LANES];
+  };
+
+  using group = std::conditional_t<WIDTH == 8U, swar_group, simd_group>;
+
   struct iterator {
     using iterator_category = std::forward_iterator_tag;
     using value_type = hash_storage::entry_t;
@@ -223,8 +394,10 @@ struct hash_storage {
   };
 
   static ctrl_t* empty_group() noexcept {
-    alignas(16) static constexpr ctrl_t empty_group[] = {
+    alignas(32) static constexpr ctrl_t empty_group[] = {
         END,   EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY,
+        EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY,
+        EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY,
         EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY};
     return const_cast<ctrl_t*>(empty_group);
   }
@@ -255,6 +428,19 @@ struct hash_storage {
     return (capacity == 7U) ? 6U : capacity - (capacity / 8U);
   }
 
+  // Smallest capacity that holds `n` entries (0 for n = 0).
+  static constexpr size_type growth_to_capacity(size_type const n) noexcept {
+    if (n == 0U) {
+      return 0U;
+    }
+    auto capacity =
+        static_cast<size_type>(normalize_capacity(n + (n - 1U) / 7U));
+    while (capacity_to_growth(capacity) < n) {
+      capacity = capacity * 2U + 1U;
+    }
+    return capacity;
+  }
+
   constexpr hash_storage() = default;
 
   hash_storage(std::initializer_list<T> init) {
@@ -273,6 +459,7 @@ struct hash_storage {
 
   hash_storage(hash_storage const& other) {
     if (other.size() != 0U) {
+      reserve(other.size());
       for (const auto& v : other) {
         emplace(v);
       }
@@ -369,7 +556,11 @@ struct hash_storage {
   // --- find()
   template <typename Key>
   iterator find_impl(Key&& key) {
-    auto const hash = compute_hash(key);
+    return find_with_hash(key, compute_hash(key));
+  }
+
+  template <typename Key>
+  iterator find_with_hash(Key const& key, size_type const hash) {
     for (auto seq = probe_seq{h1(hash), capacity_}; true; seq.next()) {
       group g{ctrl_ + seq.offset_};
       for (auto const i : g.match(h2(hash))) {
@@ -399,10 +590,96 @@ struct hash_storage {
 
   iterator find(key_type const& key) noexcept { return find_impl(key); }
 
+  // --- find_batch() / contains_batch()
+  // Looks up all keys of [first, last) and writes one result per key to
+  // `out` (find_batch: iterator, end() if not found - contains_batch: bool).
+  //
+  // Keys are processed in windows of BATCH_SIZE: hash all keys and prefetch
+  // their first ctrl group, then prefetch the entry of the first h2 match,
+  // then resolve. The cache misses of one window overlap instead of forming
+  // one dependent chain per key as with find().
+  static constexpr auto const BATCH_SIZE = std::size_t{16U};
+
+  template <typename KeyIt, typename Fn>
+  void find_batch_impl(KeyIt first, KeyIt const last, Fn&& fn) {
+    size_type hashes[BATCH_SIZE];
+    while (first != last) {
+      auto n = std::size_t{0U};
+      for (auto it = first; n != BATCH_SIZE && it != last; ++it, ++n) {
+        hashes[n] = compute_hash(*it);
+        prefetch(ptr_cast(ctrl_) + probe_seq{h1(hashes[n]), capacity_}.offset_);
+      }
+      for (auto i = std::size_t{0U}; i != n; ++i) {
+        auto const seq = probe_seq{h1(hashes[i]), capacity_};
+        if (auto const m = group{ctrl_ + seq.offset_}.match(h2(hashes[i]))) {
+          prefetch(ptr_cast(entries_) + seq.offset(*m));
+        }
+      }
+      for (auto i = std::size_t{0U}; i != n; ++i, ++first) {
+        fn(find_with_hash(*first, hashes[i]));
+      }
+    }
+  }
+
+  template <typename KeyIt, typename OutIt>
+  OutIt find_batch(KeyIt const first, KeyIt const last, OutIt out) {
+    find_batch_impl(first, last, [&](iterator const it) { *out++ = it; });
+    return out;
+  }
+
+  template <typename KeyIt, typename OutIt>
+  OutIt find_batch(KeyIt const first, KeyIt const last, OutIt out) const {
+    const_cast<hash_storage*>(this)->find_batch_impl(
+        first, last, [&](iterator const it) { *out++ = const_iterator{it}; });
+    return out;
+  }
+
+  template <typename KeyIt, typename OutIt>
+  OutIt contains_batch(KeyIt const first, KeyIt const last, OutIt out) const {
+    auto const self = const_cast<hash_storage*>(this);
+    self->find_batch_impl(first, last, [&](iterator const it) {
+      *out++ = (it != self->end());
+    });
+    return out;
+  }
+
+  static void prefetch(void const* p) noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<char const*>(p), _MM_HINT_T0);
+#elif defined(__GNUC__)
+    __builtin_prefetch(p);
+#else
+    (void)p;
+#endif
+  }
+
+  // Forward iterators: grows the table once and hashes the entries of a
+  // window of BATCH_SIZE (prefetching their ctrl groups) before placing them.
   template <class InputIt>
   void insert(InputIt first, InputIt last) {
-    for (; first != last; ++first) {
-      emplace(*first);
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+      reserve_for_insert(static_cast<size_type>(std::distance(first, last)));
+      size_type hashes[BATCH_SIZE];
+      while (first != last) {
+        auto n = std::size_t{0U};
+        for (auto it = first; n != BATCH_SIZE && it != last; ++it, ++n) {
+          hashes[n] = compute_hash(GetKey()(*it));
+          prefetch(ptr_cast(ctrl_) +
+                   probe_seq{h1(hashes[n]), capacity_}.offset_);
+        }
+        for (auto i = std::size_t{0U}; i != n; ++i, ++first) {
+          auto const res =
+              find_or_prepare_insert_with_hash(GetKey()(*first), hashes[i]);
+          if (res.second) {
+            new (entries_ + res.first) T{*first};
+          }
+        }
+      }
+    } else {
+      for (; first != last; ++first) {
+        emplace(*first);
+      }
     }
   }
 
@@ -431,6 +708,27 @@ struct hash_storage {
 
   std::pair<iterator, bool> insert(T const& entry) { return emplace(entry); }
 
+  // Hash maps: constructs the entry only if `key` is not in the map.
+  // Key may be any type accepted by find() that converts to key_type.
+  // The value is constructed from `args` in place (like std::map, e.g.
+  // try_emplace(k, 3, 0) on a vector value holds three zeros). If the
+  // construction throws, the map is unchanged.
+  template <typename Key, typename... Args>
+  std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args) {
+    auto const res = find_or_prepare_insert(key);
+    if (res.second) {
+      try {
+        new (entries_ + res.first)
+            T{static_cast<key_type>(std::forward<Key>(key)),
+              make_mapped(std::forward<Args>(args)...)};
+      } catch (...) {
+        erase_meta_only(iterator_at(res.first));
+        throw;
+      }
+    }
+    return {iterator_at(res.first), res.second};
+  }
+
   template <typename... Args>
   std::pair<iterator, bool> emplace(Args&&... args) {
     auto entry = T{std::forward<Args>(args)...};
@@ -499,6 +797,17 @@ struct hash_storage {
                WIDTH;
   }
 
+  // Parentheses (no initializer_list constructor), braces for aggregates.
+  // The returned prvalue initializes the entry member directly.
+  template <typename... Args>
+  static mapped_type make_mapped(Args&&... args) {
+    if constexpr (std::is_constructible_v<mapped_type, Args&&...>) {
+      return mapped_type(std::forward<Args>(args)...);
+    } else {
+      return mapped_type{std::forward<Args>(args)...};
+    }
+  }
+
   void erase_meta_only(const_iterator it) noexcept {
     --size_;
     auto const index = static_cast<std::size_t>(it.inner_.ctrl_ - ctrl_);
@@ -527,7 +836,12 @@ struct hash_storage {
 
   template <typename Key>
   std::pair<size_type, bool> find_or_prepare_insert(Key&& key) {
-    auto const hash = compute_hash(key);
+    return find_or_prepare_insert_with_hash(key, compute_hash(key));
+  }
+
+  template <typename Key>
+  std::pair<size_type, bool> find_or_prepare_insert_with_hash(
+      Key const& key, size_type const hash) {
     for (auto seq = probe_seq{h1(hash), capacity_}; true; seq.next()) {
       group g{ctrl_ + seq.offset_};
       for (auto const i : g.match(h2(hash))) {
@@ -569,10 +883,98 @@ struct hash_storage {
         static_cast<ctrl_t>(c);
   }
 
+  // Grows the table (once) so that `n` entries fit without rehashing.
+  void reserve(size_type const n) {
+    auto const capacity = growth_to_capacity(n);
+    if (capacity > capacity_) {
+      resize(capacity);
+    }
+  }
+
+  // Makes room for `n` inserts without rehashing in between (removes the
+  // tombstones of erased entries if necessary).
+  void reserve_for_insert(size_type const n) {
+    reserve(size_ + n);
+    if (growth_left_ < n) {
+      rehash();
+    }
+  }
+
+  // Called if there is no empty slot left for an insert. If tombstones of
+  // erased entries take up at least 3/32 of the slots (size <= 25/32 of the
+  // capacity), they are removed in place instead of doubling the capacity:
+  // insert/erase churn does not grow the table.
   void rehash_and_grow_if_necessary() {
-    resize(capacity_ == 0U ? 1U : capacity_ * 2U + 1U);
+    if (capacity_ > WIDTH &&
+        static_cast<std::uint64_t>(size_) * 32U <=
+            static_cast<std::uint64_t>(capacity_) * 25U) {
+      drop_deletes_without_resize();
+    } else {
+      resize(capacity_ == 0U ? 1U : capacity_ * 2U + 1U);
+    }
+  }
+
+  // Removes all tombstones without reallocating (abseil's
+  // DropDeletesWithoutResize): full slots are marked DELETED, deleted slots
+  // EMPTY. Each marked entry then stays where it is if its first free slot
+  // is in the same probe group, or is moved there (to an empty slot or by
+  // swapping with another marked entry, which is processed next).
+  void drop_deletes_without_resize() {
+    for (size_type i = 0U; i != capacity_; ++i) {
+      ctrl_[i] = is_full(ctrl_[i]) ? DELETED : EMPTY;
+    }
+    std::memcpy(ctrl_ + capacity_ + 1U, ctrl_, WIDTH);
+    ctrl_[capacity_] = END;
+
+    for (size_type i = 0U; i != capacity_; ++i) {
+      if (!is_deleted(ctrl_[i])) {
+        continue;
+      }
+
+      auto const hash = compute_hash(GetKey()(entries_[i]));
+      auto const new_i = find_first_non_full(hash).offset_;
+      auto const probe_offset = probe_seq{h1(hash), capacity_}.offset_;
+      auto const probe_index = [&](size_type const pos) {
+        return ((pos - probe_offset) & capacity_) / WIDTH;
+      };
+
+      if (probe_index(new_i) == probe_index(i)) {
+        set_ctrl(i, h2(hash));
+        continue;
+      }
+
+      if (is_empty(ctrl_[new_i])) {
+        set_ctrl(new_i, h2(hash));
+        new (entries_ + new_i) T{std::move(entries_[i])};
+        entries_[i].~T();
+        set_ctrl(i, static_cast<h2_t>(EMPTY));
+      } else {
+        set_ctrl(new_i, h2(hash));
+        auto tmp = T{std::move(entries_[i])};
+        entries_[i].~T();
+        new (entries_ + i) T{std::move(entries_[new_i])};
+        entries_[new_i].~T();
+        new (entries_ + new_i) T{std::move(tmp)};
+        --i;  // process the entry swapped into slot i
+      }
+    }
+
+    reset_growth_left();
+  }
+
+  // Rehashes into the smallest table that holds max(n, size()) entries:
+  // shrinks the table and removes all tombstones. rehash(0) on an empty
+  // table releases its memory.
+  void rehash(size_type const n) {
+    if (n == 0U && size_ == 0U) {
+      clear();
+      return;
+    }
+    resize(growth_to_capacity(n > size_ ? n : size_));
   }
 
+  void shrink_to_fit() { rehash(0U); }
+
   void reset_growth_left() noexcept {
     growth_left_ = capacity_to_growth(capacity_) - size_;
   }
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <iterator>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "cista/containers/hash_storage.h"
+#include "cista/decay.h"
+#include "cista/parallel_for.h"
+
+namespace cista {
+
+// Inserts [first, last) into `h` with up to `num_threads` threads.
+//
+// The table is split into regions of REGION_SIZE slots, each filled by one
+// thread at a time:
+//   1. parallel: hash the inputs, group them by the region of the first
+//      group of their probe sequence (input order within a region)
+//   2. parallel, per region: insert the entry if its first group has a free
+//      slot - otherwise (or if the group crosses the region end) defer it
+//   3. sequential: insert the deferred entries in input order (insert())
+//
+// The layout does not depend on the number of threads: it is the layout of
+// insert() with the entries of step 2 (by region) before the deferred ones,
+// so repeated builds serialize to the same bytes. Entries with equal keys:
+// the first one in input order is inserted (like insert()).
+//
+// If copying an entry throws, the entries inserted so far stay in the table
+// and the exception is rethrown.
+template <typename T, template <typename> typename Ptr, typename GetKey,
+          typename GetValue, typename Hash, typename Eq, std::size_t Width,
+          typename It>
+void parallel_insert(
+    hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq, Width>& h,
+    It const first, It const last,
+    std::size_t const num_threads = std::thread::hardware_concurrency()) {
+  using storage_t = hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq, Width>;
+  using size_type = typename storage_t::size_type;
+  using probe_seq = typename storage_t::probe_seq;
+  using group = typename storage_t::group;
+
+  static_assert(
+      std::is_base_of_v<std::random_access_iterator_tag,
+                        typename std::iterator_traits<It>::iterator_category>,
+      "parallel_insert: random access iterator required");
+  static_assert(std::is_same_v<decay_t<decltype(*first)>, T>,
+                "parallel_insert: input has to be the entry type");
+
+  constexpr auto const REGION_SIZE = std::size_t{16U * 1024U};
+  constexpr auto const MIN_CHUNK_SIZE = std::size_t{64U * 1024U};
+
+  auto const n = static_cast<std::size_t>(std::distance(first, last));
+  if (n == 0U) {
+    return;
+  }
+
+  auto const key = [&](std::size_t const i) -> decltype(auto) {
+    return GetKey()(first[i]);
+  };
+
+  h.reserve_for_insert(static_cast<size_type>(n));
+  auto const existing = h.size_ != 0U;
+  auto const capacity = static_cast<std::size_t>(h.capacity_);
+  auto const num_regions = (capacity + REGION_SIZE - 1U) / REGION_SIZE;
+  auto const deferred_bucket = num_regions;
+
+  // 1. Hash and group by region (counting sort of contiguous input chunks:
+  // input order within each region, independent of the thread count).
+  auto const num_chunks = std::max(
+      std::size_t{1U}, std::min(n / MIN_CHUNK_SIZE, 4U * num_threads));
+  auto const chunk_begin = [&](std::size_t const c) {
+    return n * c / num_chunks;
+  };
+
+  auto hashes = std::vector<size_type>(n);
+  auto buckets = std::vector<std::uint32_t>(n);  // region or deferred
+  auto counts = std::vector<std::size_t>(num_chunks * (num_regions + 1U));
+  parallel_for(num_chunks, num_threads, [&](std::size_t const c) {
+    auto const chunk_counts = &counts[c * (num_regions + 1U)];
+    for (auto i = chunk_begin(c); i != chunk_begin(c + 1U); ++i) {
+      auto const hash = h.compute_hash(key(i));
+      auto const offset = static_cast<std::size_t>(
+          probe_seq{storage_t::h1(hash), h.capacity_}.offset_);
+      auto const region = offset / REGION_SIZE;
+      auto const region_end =
+          std::min(capacity, (region + 1U) * REGION_SIZE);
+      auto const in_table =
+          existing && h.find_with_hash(key(i), hash) != h.end();
+      auto const bucket = in_table ? num_regions + 1U  // skipped
+                          : offset + storage_t::WIDTH <= region_end
+                              ? region
+                              : deferred_bucket;
+      hashes[i] = hash;
+      buckets[i] = static_cast<std::uint32_t>(bucket);
+      if (bucket <= num_regions) {
+        ++chunk_counts[bucket];
+      }
+    }
+  });
+
+  auto bucket_begin = std::vector<std::size_t>(num_regions + 2U);
+  {
+    auto sum = std::size_t{0U};
+    for (auto b = std::size_t{0U}; b != num_regions + 1U; ++b) {
+      bucket_begin[b] = sum;
+      for (auto c = std::size_t{0U}; c != num_chunks; ++c) {
+        auto& count = counts[c * (num_regions + 1U) + b];
+        auto const chunk_count = count;
+        count = sum;  // -> write position of chunk c in bucket b
+        sum += chunk_count;
+      }
+    }
+    bucket_begin[num_regions + 1U] = sum;
+  }
+
+  struct input {
+    size_type hash_, index_;
+  };
+  auto order = std::vector<input>(bucket_begin.back());
+  parallel_for(num_chunks, num_threads, [&](std::size_t const c) {
+    auto const positions = &counts[c * (num_regions + 1U)];
+    for (auto i = chunk_begin(c); i != chunk_begin(c + 1U); ++i) {
+      if (buckets[i] <= num_regions) {
+        order[positions[buckets[i]]++] = {hashes[i],
+                                          static_cast<size_type>(i)};
+      }
+    }
+  });
+  hashes = {};
+  buckets = {};
+  counts = {};
+
+  // 2. Regions: first group only.
+  struct region_result {
+    std::size_t inserted_{0U}, used_empty_{0U};
+    std::vector<input> deferred_;
+  };
+  auto results = std::vector<region_result>(num_regions);
+  auto const apply_counts = [&]() {
+    for (auto const& r : results) {
+      h.size_ += static_cast<size_type>(r.inserted_);
+      h.growth_left_ -= static_cast<size_type>(r.used_empty_);
+    }
+  };
+
+  try {
+    parallel_for(num_regions, num_threads, [&](std::size_t const region) {
+      auto& r = results[region];
+      for (auto o = bucket_begin[region]; o != bucket_begin[region + 1U];
+           ++o) {
+        auto const i = static_cast<std::size_t>(order[o].index_);
+        auto const hash = order[o].hash_;
+        auto const offset =
+            probe_seq{storage_t::h1(hash), h.capacity_}.offset_;
+        auto const g = group{h.ctrl_ + offset};
+
+        auto duplicate = false;
+        for (auto const j : g.match(storage_t::h2(hash))) {
+          if (Eq{}(GetKey()(h.entries_[offset + j]), key(i))) {
+            duplicate = true;
+            break;
+          }
+        }
+        if (duplicate) {
+          continue;
+        }
+
+        auto const free = g.match_empty_or_deleted();
+        if (!free) {
+          r.deferred_.push_back(order[o]);
+          continue;
+        }
+
+        auto const s = offset + *free;
+        auto const was_empty = storage_t::is_empty(h.ctrl_[s]);
+        new (h.entries_ + s) T{first[i]};
+        h.set_ctrl(s, storage_t::h2(hash));
+        ++r.inserted_;
+        r.used_empty_ += was_empty ? 1U : 0U;
+      }
+    });
+  } catch (...) {
+    apply_counts();
+    throw;
+  }
+  apply_counts();
+
+  // 3. Deferred entries in input order.
+  auto deferred = std::vector<input>(
+      begin(order) + static_cast<std::ptrdiff_t>(bucket_begin[num_regions]),
+      end(order));
+  order = {};
+  for (auto& r : results) {
+    deferred.insert(end(deferred), begin(r.deferred_), end(r.deferred_));
+    r.deferred_ = {};
+  }
+  std::sort(
+      begin(deferred), end(deferred),
+      [](input const& a, input const& b) { return a.index_ < b.index_; });
+
+  for (auto const [hash, i] : deferred) {
+    auto const res = h.find_or_prepare_insert_with_hash(key(i), hash);
+    if (res.second) {
+      try {
+        new (h.entries_ + res.first) T{first[i]};
+      } catch (...) {
+        h.erase_meta_only(h.iterator_at(res.first));
+        throw;
+      }
+    }
+  }
+}
+
+}  // namespace cista
@@ -0,0 +1,184 @@
+#pragma once
+
+#ifndef _WIN32
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "cista/buffer.h"
+#include "cista/hash.h"
+#include "cista/memory_holder.h"
+#include "cista/mode.h"
+#include "cista/parallel_for.h"
+#include "cista/posix_io.h"
+#include "cista/segmented_hash.h"
+#include "cista/serialization.h"
+#include "cista/verify.h"
+
+namespace cista {
+
+constexpr auto const HUGE_PAGE_SIZE = std::size_t{2U * 1024U * 1024U};
+
+struct load_options {
+  std::size_t num_threads_{std::thread::hardware_concurrency()};
+  std::size_t chunk_size_{4U * HUGE_PAGE_SIZE};  // multiple of SEGMENT_SIZE
+  bool huge_pages_{true};  // MADV_HUGEPAGE (Linux, if enabled)
+};
+
+// Buffer aligned to HUGE_PAGE_SIZE. Released with std::free by cista::buffer.
+inline buffer huge_page_buffer(std::size_t const size, bool const huge_pages) {
+  auto b = buffer{};
+  if (size == 0U) {
+    return b;
+  }
+
+  auto const capacity = (size + HUGE_PAGE_SIZE - 1U) & ~(HUGE_PAGE_SIZE - 1U);
+  void* mem = nullptr;
+  verify(::posix_memalign(&mem, HUGE_PAGE_SIZE, capacity) == 0,
+         "buffer initialization failed");
+#ifdef MADV_HUGEPAGE
+  if (huge_pages) {
+    ::madvise(mem, capacity, MADV_HUGEPAGE);  // only a hint
+  }
+#else
+  (void)huge_pages;
+#endif
+  b.buf_ = mem;
+  b.size_ = size;
+  return b;
+}
+
+// Reads the whole file with concurrent pread() calls (one chunk at a time per
+// thread) into a huge page aligned buffer.
+//
+// If `segment_hashes` is set, the segment hashes (see segmented_hash.h) of
+// [hash_from, hash_to) are computed by the thread that read the chunk while
+// the data is still in the CPU cache. Chunks start at hash_from so that no
+// segment spans two chunks.
+inline buffer load_file(int const fd, load_options const& o = {},
+                        std::vector<hash_t>* segment_hashes = nullptr,
+                        std::size_t const hash_from = 0U,
+                        std::size_t const hash_to = 0U) {
+  verify(o.chunk_size_ != 0U && o.chunk_size_ % SEGMENT_SIZE == 0U,
+         "load file: chunk size not a multiple of the segment size");
+
+  auto const size = file_size(fd);
+  verify(segment_hashes == nullptr || (hash_from <= hash_to && hash_to <= size),
+         "load file: invalid hash range");
+
+  auto b = huge_page_buffer(size, o.huge_pages_);
+  auto const hashed = std::string_view{
+      reinterpret_cast<char const*>(b.data()) + hash_from,
+      segment_hashes == nullptr ? 0U : hash_to - hash_from};
+  if (segment_hashes != nullptr) {
+    segment_hashes->resize(num_segments(hashed.size()));
+  }
+  if (size == 0U) {
+    return b;
+  }
+
+  auto const chunk_end = [&](std::size_t const i) {
+    return std::min(size, hash_from + (i + 1U) * o.chunk_size_);
+  };
+  auto const num_chunks =
+      1U + (size - chunk_end(0U) + o.chunk_size_ - 1U) / o.chunk_size_;
+  parallel_for(num_chunks, o.num_threads_, [&](std::size_t const i) {
+    auto const from = i == 0U ? 0U : hash_from + i * o.chunk_size_;
+    auto const to = chunk_end(i);
+    pread_all(fd, b.data() + from, to - from, from);
+
+    if (segment_hashes == nullptr) {
+      return;
+    }
+    auto const lo = std::max(from, hash_from);
+    auto const hi = std::min(to, hash_to);
+    for (auto s = (lo - hash_from) / SEGMENT_SIZE;
+         lo < hi && s != num_segments(hi - hash_from); ++s) {
+      (*segment_hashes)[s] = segment_hash(hashed, s);
+    }
+  });
+
+  return b;
+}
+
+inline buffer load_file(char const* path, load_options const& o = {}) {
+  struct closer {
+    ~closer() { ::close(fd_); }
+    int fd_;
+  } f{open_for_reading(path)};
+  return load_file(f.fd_, o);
+}
+
+// Loads, verifies and deserializes a file written with `Mode`.
+//
+// WITH_SEGMENTED_INTEGRITY and WITH_BLOCK_INTEGRITY are verified with the
+// segment hashes computed while loading: loading and verifying is one pass
+// over the data. WITH_INTEGRITY is a sequential hash and still verified by
+// a second pass (deserialize).
+template <typename T, mode const Mode = mode::NONE>
+wrapped<T> load(char const* path, load_options const& o = {}) {
+  struct closer {
+    ~closer() { ::close(fd_); }
+    int fd_;
+  } f{open_for_reading(path)};
+
+  if constexpr (is_mode_enabled(Mode, mode::WITH_SEGMENTED_INTEGRITY)) {
+    auto const size = file_size(f.fd_);
+    verify(size > static_cast<std::size_t>(data_start(Mode)), "invalid range");
+
+    auto hashes = std::vector<hash_t>{};
+    auto b = load_file(f.fd_, o, &hashes, data_start(Mode), size);
+    verify(b.size() == size, "file changed while loading");
+
+    auto stored = hash_t{};
+    std::memcpy(&stored, b.data() + integrity_start(Mode), sizeof(stored));
+    verify(convert_endian<Mode>(stored) == combine_segment_hashes(hashes),
+           "invalid segmented checksum");
+
+    // Same layout, integrity already verified.
+    using underlying_t = std::underlying_type_t<mode>;
+    constexpr auto const VERIFIED_MODE =
+        mode{static_cast<underlying_t>(Mode) &
+             ~static_cast<underlying_t>(mode::WITH_SEGMENTED_INTEGRITY)} |
+        mode::SKIP_INTEGRITY;
+    auto const el = deserialize<T, VERIFIED_MODE>(b);
+    return wrapped<T>{std::move(b), el};
+  } else if constexpr (is_mode_enabled(Mode, mode::WITH_BLOCK_INTEGRITY)) {
+    // The block table at the end of the file determines the hashed range.
+    auto const size = file_size(f.fd_);
+    auto n = std::uint64_t{0U};
+    verify(size >= data_start(Mode) + sizeof(n), "block table missing");
+    pread_all(f.fd_, &n, sizeof(n), size - sizeof(n));
+    n = convert_endian<Mode>(n);
+    verify(n <= (size - data_start(Mode) - sizeof(n)) / sizeof(hash_t),
+           "block table truncated");
+
+    auto hashes = std::vector<hash_t>{};
+    auto b = load_file(f.fd_, o, &hashes, data_start(Mode),
+                       size - sizeof(n) - n * sizeof(hash_t));
+    verify(b.size() == size, "file changed while loading");
+
+    auto integrity =
+        make_block_integrity<Mode>(b.data(), b.data() + b.size());
+    integrity.set_verified(hashes);
+    auto const el =
+        deserialize<T, Mode>(b.data(), b.data() + b.size(), integrity);
+    return wrapped<T>{std::move(b), el};
+  } else {
+    auto b = load_file(f.fd_, o);
+    auto const el = deserialize<T, Mode>(b);
+    return wrapped<T>{std::move(b), el};
+  }
+}
+
+}  // namespace cista
+
+#endif
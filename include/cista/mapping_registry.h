@@ -0,0 +1,152 @@
+#pragma once
+
+#ifndef _WIN32
+
+#include <sys/stat.h>
+
+#include <cinttypes>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+#include "cista/memory_holder.h"
+#include "cista/mmap.h"
+#include "cista/mode.h"
+#include "cista/serialization.h"
+#include "cista/type_hash/type_hash.h"
+#include "cista/verify.h"
+
+namespace cista {
+
+// Process-wide registry of mapped and verified files. Components that open
+// the same file (same device, inode, modification time and size) with the
+// same type and mode share one mapping:
+//
+//   auto const d = cista::mapping_registry::global().open<T, MODE>(path);
+//   d->member_;  // std::shared_ptr<T const>
+//
+// The file is mapped (copy-on-write, see mmap::protection::PRIVATE) and
+// verified by the first open(). It is unmapped when the last handle is gone.
+// A file replaced with rename() is a new file (new inode): open() maps the
+// new file while handles to the old one stay valid.
+//
+// global() is an inline function-local static: shared libraries built with
+// hidden visibility get one instance each. To share
+// mappings across libraries, create the registry in exactly one library
+// and pass it to the others (or export a function returning global()).
+struct mapping_registry {
+  static mapping_registry& global() {
+    static auto r = mapping_registry{};
+    return r;
+  }
+
+  template <typename T, mode const Mode = mode::NONE>
+  std::shared_ptr<T const> open(char const* path) {
+    // Identify the file that is actually mapped, not the one the path
+    // points to now (it may have been replaced in between).
+    auto m = mmap{path, mmap::protection::PRIVATE};
+    auto const e = get_entry(key{file_id(m.fd()), Mode, type_key<T>()});
+
+    auto const lock = std::lock_guard{e->mutex_};
+    if (auto const existing = e->data_.lock(); existing != nullptr) {
+      return std::static_pointer_cast<T const>(existing);
+    }
+
+    auto const el = deserialize<T, Mode>(m);
+    auto const w = std::make_shared<wrapped<T>>(buf<mmap>{std::move(m)}, el);
+    auto const data = std::shared_ptr<T const>{w, w->get()};
+    e->data_ = data;
+    return data;
+  }
+
+  // Number of files currently mapped through this registry.
+  std::size_t size() const {
+    auto const lock = std::lock_guard{mutex_};
+    auto n = std::size_t{0U};
+    for (auto const& [k, e] : entries_) {
+      auto const entry_lock = std::lock_guard{e->mutex_};
+      n += e->data_.expired() ? 0U : 1U;
+    }
+    return n;
+  }
+
+private:
+  struct file_id_t {
+    friend bool operator==(file_id_t const& a, file_id_t const& b) {
+      return std::tie(a.dev_, a.ino_, a.mtime_ns_, a.size_) ==
+             std::tie(b.dev_, b.ino_, b.mtime_ns_, b.size_);
+    }
+    friend bool operator<(file_id_t const& a, file_id_t const& b) {
+      return std::tie(a.dev_, a.ino_, a.mtime_ns_, a.size_) <
+             std::tie(b.dev_, b.ino_, b.mtime_ns_, b.size_);
+    }
+
+    std::uint64_t dev_, ino_, mtime_ns_, size_;
+  };
+
+  struct key {
+    friend bool operator<(key const& a, key const& b) {
+      return std::tie(a.file_, a.mode_, a.type_) <
+             std::tie(b.file_, b.mode_, b.type_);
+    }
+
+    file_id_t file_;
+    mode mode_;
+    hash_t type_;
+  };
+
+  struct entry {
+    std::mutex mutex_;  // held while mapping and verifying
+    std::weak_ptr<void const> data_;
+  };
+
+  // Same in every library (unlike the address of a static): types with the
+  // same type_hash() have the same layout and share the mapping.
+  template <typename T>
+  static hash_t type_key() {
+    static auto const h = type_hash<T>();
+    return h;
+  }
+
+  static file_id_t file_id(int const fd) {
+    struct stat s;
+    verify(::fstat(fd, &s) == 0, "fstat error");
+#ifdef __APPLE__
+    auto const& mtime = s.st_mtimespec;
+#else
+    auto const& mtime = s.st_mtim;
+#endif
+    return {static_cast<std::uint64_t>(s.st_dev),
+            static_cast<std::uint64_t>(s.st_ino),
+            static_cast<std::uint64_t>(mtime.tv_sec) * 1'000'000'000U +
+                static_cast<std::uint64_t>(mtime.tv_nsec),
+            static_cast<std::uint64_t>(s.st_size)};
+  }
+
+  std::shared_ptr<entry> get_entry(key const& k) {
+    auto const lock = std::lock_guard{mutex_};
+
+    // Drop entries of unmapped files nobody is opening right now.
+    for (auto it = begin(entries_); it != end(entries_);) {
+      if (it->second.use_count() == 1 && it->second->data_.expired()) {
+        it = entries_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    auto& e = entries_[k];
+    if (e == nullptr) {
+      e = std::make_shared<entry>();
+    }
+    return e;
+  }
+
+  mutable std::mutex mutex_;
+  std::map<key, std::shared_ptr<entry>> entries_;
+};
+
+}  // namespace cista
+
+#endif
@@ -15,6 +15,7 @@
 #include <unistd.h>
 #endif
 
+#include "cista/advise.h"
 #include "cista/next_power_of_2.h"
 #include "cista/targets/file.h"
 
@@ -24,26 +25,54 @@ struct mmap {
   static constexpr auto const OFFSET = 0ULL;
   static constexpr auto const ENTIRE_FILE =
       std::numeric_limits<std::size_t>::max();
-  enum class protection { READ, WRITE, MODIFY };
+  // PRIVATE: copy-on-write mapping of a read-only file. Writes (e.g. pointer
+  // fix-ups by deserialize) copy the touched pages and are never written back
+  // to the file. Pages not written stay shared with the page cache.
+  enum class protection { READ, WRITE, MODIFY, PRIVATE };
+
+  // SYNC_ON_CLOSE: the destructor blocks until all data is on disk.
+  // NONE: the destructor only unmaps (the kernel writes back later).
+  enum class durability { NONE, SYNC_ON_CLOSE };
+
+  // NONE: pages are read on first access (page fault).
+  // POPULATE: all pages are read when mapping (Linux: MAP_POPULATE).
+  // PRIVATE mappings only read ahead (WILLNEED): pages are still copied on
+  // the first write only.
+  enum class prefault { NONE, POPULATE };
 
   mmap() = default;
 
-  explicit mmap(char const* path, protection const prot = protection::WRITE)
+  explicit mmap(char const* path, protection const prot = protection::WRITE,
+                durability const d = durability::SYNC_ON_CLOSE)
+      : mmap{path, prot, d, advice::NORMAL, prefault::NONE} {}
+
+  // Read-only mapping with an access hint (see advise.h) for the whole file.
+  mmap(char const* path, advice const a, prefault const p = prefault::NONE)
+      : mmap{path, protection::READ, durability::NONE, a, p} {}
+
+  mmap(char const* path, protection const prot, durability const d,
+       advice const a, prefault const p)
       : f_{path, prot == protection::MODIFY
                      ? "r+"
-                     : (prot == protection::READ ? "r" : "w+")},
+                     : (prot == protection::READ || prot == protection::PRIVATE
+                            ? "r"
+                            : "w+")},
         prot_{prot},
+        durability_{d},
+        advice_{a},
+        prefault_{p},
         size_{f_.size()},
         used_size_{f_.size()},
         addr_{size_ == 0U ? nullptr : map()} {}
 
   ~mmap() {
     if (addr_ != nullptr) {
-      sync();
-      size_ = used_size_;
+      if (durability_ == durability::SYNC_ON_CLOSE) {
+        sync();
+      }
       unmap();
-      if (size_ != f_.size()) {
-        resize_file();
+      if (used_size_ != f_.size()) {
+        resize_file(used_size_);
       }
     }
   }
@@ -54,6 +83,9 @@ struct mmap {
   mmap(mmap&& o)
       : f_{std::move(o.f_)},
         prot_{o.prot_},
+        durability_{o.durability_},
+        advice_{o.advice_},
+        prefault_{o.prefault_},
         size_{o.size_},
         used_size_{o.used_size_},
         addr_{o.addr_} {
@@ -66,6 +98,9 @@ struct mmap {
   mmap& operator=(mmap&& o) {
     f_ = std::move(o.f_);
     prot_ = o.prot_;
+    durability_ = o.durability_;
+    advice_ = o.advice_;
+    prefault_ = o.prefault_;
     size_ = o.size_;
     used_size_ = o.used_size_;
     addr_ = o.addr_;
@@ -88,6 +123,43 @@ struct mmap {
     }
   }
 
+  // Writes [offset, offset + size) back to the file. With `async`, the
+  // write-back is only started (Windows: no flush of the file buffers).
+  void sync_range(std::size_t const offset, std::size_t const size,
+                  bool const async = false) {
+    if ((prot_ != protection::WRITE && prot_ != protection::MODIFY) ||
+        addr_ == nullptr || size == 0U) {
+      return;
+    }
+    verify(offset <= size_ && size <= size_ - offset, "sync out of bounds");
+#ifdef _WIN32
+    verify(::FlushViewOfFile(data() + offset, size) != 0, "flush error");
+    if (!async) {
+      verify(::FlushFileBuffers(f_.f_) != 0, "flush error");
+    }
+#else
+    auto const page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    auto const from = offset & ~(page_size - 1U);
+    verify(::msync(data() + from, offset + size - from,
+                   async ? MS_ASYNC : MS_SYNC) == 0,
+           "sync error");
+#endif
+  }
+
+  // Applies `a` to the pages overlapping [offset, offset + size).
+  // Returns false if the hint is not supported.
+  bool advise(std::size_t const offset, std::size_t const size,
+              advice const a) {
+    verify(offset <= used_size_ && size <= used_size_ - offset,
+           "advise out of bounds");
+    return addr_ == nullptr || cista::advise(data() + offset, size, a);
+  }
+
+  bool advise(advice const a) {
+    advice_ = a;
+    return advise(0U, used_size_, a);
+  }
+
   void resize(std::size_t const new_size) {
     verify(prot_ == protection::WRITE || prot_ == protection::MODIFY,
            "read-only not resizable");
@@ -107,6 +179,11 @@ struct mmap {
 
   std::size_t size() const noexcept { return used_size_; }
 
+#ifndef _WIN32
+  // Descriptor of the mapped file (e.g. for fstat()).
+  int fd() const { return f_.fd(); }
+#endif
+
   std::string_view view() const noexcept {
     return {static_cast<char const*>(addr_), size()};
   }
@@ -151,30 +228,52 @@ private:
 #else
     auto const size_high = static_cast<DWORD>(0U);
 #endif
-    const auto fm = ::CreateFileMapping(
-        f_.f_, 0, prot_ == protection::READ ? PAGE_READONLY : PAGE_READWRITE,
-        size_high, size_low, 0);
+    auto const page_protection =
+        prot_ == protection::READ
+            ? PAGE_READONLY
+            : (prot_ == protection::PRIVATE ? PAGE_WRITECOPY : PAGE_READWRITE);
+    const auto fm = ::CreateFileMapping(f_.f_, 0, page_protection, size_high,
+                                        size_low, 0);
     verify(fm != NULL, "file mapping error");
     file_mapping_ = fm;
 
-    auto const addr = ::MapViewOfFile(
-        fm, prot_ == protection::READ ? FILE_MAP_READ : FILE_MAP_WRITE, OFFSET,
-        OFFSET, size_);
+    auto const access =
+        prot_ == protection::READ
+            ? FILE_MAP_READ
+            : (prot_ == protection::PRIVATE ? FILE_MAP_COPY : FILE_MAP_WRITE);
+    auto const addr = ::MapViewOfFile(fm, access, OFFSET, OFFSET, size_);
     verify(addr != nullptr, "map error");
 
     return addr;
 #else
+    auto flags = prot_ == protection::PRIVATE ? MAP_PRIVATE : MAP_SHARED;
+
+    // MAP_POPULATE on a writable private mapping copies every page (it
+    // prefaults for write). Only start reading the file into the page cache.
+    auto populate = prefault_ == prefault::POPULATE;
+#ifdef MAP_POPULATE
+    if (populate && prot_ != protection::PRIVATE) {
+      flags |= MAP_POPULATE;
+      populate = false;
+    }
+#endif
     auto const addr =
         ::mmap(nullptr, size_,
                prot_ == protection::READ ? PROT_READ : PROT_READ | PROT_WRITE,
-               MAP_SHARED, f_.fd(), OFFSET);
+               flags, f_.fd(), OFFSET);
     verify(addr != MAP_FAILED, "map error");
+    if (populate) {
+      cista::advise(addr, size_, advice::WILLNEED);
+    }
+    if (advice_ != advice::NORMAL) {
+      cista::advise(addr, size_, advice_);
+    }
     return addr;
 #endif
   }
 
-  void resize_file() {
-    if (prot_ == protection::READ) {
+  void resize_file(std::size_t const size) {
+    if (prot_ == protection::READ || prot_ == protection::PRIVATE) {
       return;
     }
 
@@ -183,29 +282,45 @@ private:
     verify(::GetFileSizeEx(f_.f_, &Size), "resize: get file size error");
 
     LARGE_INTEGER Distance = {0};
-    Distance.QuadPart = size_ - Size.QuadPart;
+    Distance.QuadPart = size - Size.QuadPart;
     verify(::SetFilePointerEx(f_.f_, Distance, nullptr, FILE_END),
            "resize error");
     verify(::SetEndOfFile(f_.f_), "resize set eof error");
 #else
-    verify(::ftruncate(f_.fd(), static_cast<off_t>(size_)) == 0,
+    verify(::ftruncate(f_.fd(), static_cast<off_t>(size)) == 0,
            "resize error");
 #endif
   }
 
   void resize_map(std::size_t const new_size) {
-    if (prot_ == protection::READ) {
+    if (prot_ == protection::READ || prot_ == protection::PRIVATE) {
       return;
     }
 
+#ifdef __linux__
+    // Grow the existing mapping: no unmap/map, the page tables are moved
+    // by the kernel (the address changes only if the range is occupied).
+    if (addr_ != nullptr) {
+      resize_file(new_size);
+      auto const addr = ::mremap(addr_, size_, new_size, MREMAP_MAYMOVE);
+      verify(addr != MAP_FAILED, "remap error");
+      addr_ = addr;
+      size_ = new_size;
+      return;
+    }
+#endif
+
     unmap();
     size_ = new_size;
-    resize_file();
+    resize_file(size_);
     addr_ = map();
   }
 
   file f_;
   protection prot_;
+  durability durability_;
+  advice advice_{advice::NORMAL};
+  prefault prefault_{prefault::NONE};
   std::size_t size_;
   std::size_t used_size_;
   void* addr_;
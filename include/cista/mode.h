@@ -15,6 +15,9 @@ enum class mode {
   WITH_STATIC_VERSION = 1U << 6U,
   SKIP_INTEGRITY = 1U << 7U,
   SKIP_VERSION = 1U << 8U,
+  WITH_RELOCATIONS = 1U << 9U,
+  WITH_SEGMENTED_INTEGRITY = 1U << 10U,
+  WITH_BLOCK_INTEGRITY = 1U << 11U,
   _CONST = 1U << 29U,
   _PHASE_II = 1U << 30U
 };
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace cista {
+
+// Runs fn(i) for all i in [0, n) on up to `num_threads` threads.
+// The first exception is rethrown after all threads have finished.
+template <typename Fn>
+void parallel_for(std::size_t const n, std::size_t const num_threads,
+                  Fn&& fn) {
+  auto next = std::atomic_size_t{0U};
+  auto errors = std::vector<std::exception_ptr>(n);
+  auto const run = [&]() {
+    for (auto i = next.fetch_add(1U); i < n; i = next.fetch_add(1U)) {
+      try {
+        fn(i);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+
+  auto threads = std::vector<std::thread>{};
+  for (auto i = std::size_t{1U}; i < std::min(n, num_threads); ++i) {
+    threads.emplace_back(run);
+  }
+  run();
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  for (auto const& e : errors) {
+    if (e != nullptr) {
+      std::rethrow_exception(e);
+    }
+  }
+}
+
+}  // namespace cista
@@ -0,0 +1,69 @@
+#pragma once
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstddef>
+
+#include "cista/verify.h"
+
+namespace cista {
+
+inline int open_for_writing(char const* path, int const flags = 0) {
+  auto const fd =
+      ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC | flags, 0644);
+  verify(fd != -1, "unable to open file");
+  return fd;
+}
+
+inline int open_for_reading(char const* path) {
+  auto const fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  verify(fd != -1, "unable to open file");
+  return fd;
+}
+
+inline std::size_t file_size(int const fd) {
+  struct stat s;
+  verify(::fstat(fd, &s) != -1, "fstat error");
+  return static_cast<std::size_t>(s.st_size);
+}
+
+inline void pwrite_all(int const fd, void const* ptr, std::size_t size,
+                       std::size_t pos) {
+  auto data = static_cast<std::uint8_t const*>(ptr);
+  while (size != 0U) {
+    auto const n = ::pwrite(fd, data, size, static_cast<off_t>(pos));
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    verify(n > 0, "pwrite error");
+    data += n;
+    size -= static_cast<std::size_t>(n);
+    pos += static_cast<std::size_t>(n);
+  }
+}
+
+inline void pread_all(int const fd, void* ptr, std::size_t size,
+                      std::size_t pos) {
+  auto out = static_cast<std::uint8_t*>(ptr);
+  while (size != 0U) {
+    auto const n = ::pread(fd, out, size, static_cast<off_t>(pos));
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    verify(n > 0, "pread error");
+    out += n;
+    size -= static_cast<std::size_t>(n);
+    pos += static_cast<std::size_t>(n);
+  }
+}
+
+}  // namespace cista
+
+#endif
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+namespace cista {
+
+// Stable LSD radix sort by an unsigned 64bit key.
+// Digits that are equal for all keys (e.g. the upper bits of addresses
+// within one heap) are skipped, so sorting pointers typically takes only a
+// few linear passes.
+template <typename T, typename GetKey>
+void radix_sort(std::vector<T>& v, GetKey&& get_key) {
+  constexpr auto const SMALL = std::size_t{256U};
+  constexpr auto const DIGIT_BITS = 11U;
+  constexpr auto const BUCKETS = std::size_t{1U} << DIGIT_BITS;
+  constexpr auto const MASK = std::uint64_t{BUCKETS - 1U};
+  constexpr auto const PASSES = (64U + DIGIT_BITS - 1U) / DIGIT_BITS;
+
+  if (v.size() < SMALL) {
+    std::stable_sort(begin(v), end(v), [&](T const& a, T const& b) {
+      return get_key(a) < get_key(b);
+    });
+    return;
+  }
+
+  auto counts = std::vector<std::size_t>(PASSES * BUCKETS, 0U);
+  for (auto const& el : v) {
+    auto const key = static_cast<std::uint64_t>(get_key(el));
+    for (auto pass = 0U; pass != PASSES; ++pass) {
+      ++counts[pass * BUCKETS + ((key >> (pass * DIGIT_BITS)) & MASK)];
+    }
+  }
+
+  auto tmp = std::vector<T>(v.size());
+  auto* src = &v;
+  auto* dst = &tmp;
+  auto const first_key = static_cast<std::uint64_t>(get_key(v.front()));
+  for (auto pass = 0U; pass != PASSES; ++pass) {
+    auto const shift = pass * DIGIT_BITS;
+    auto const bucket_counts = &counts[pass * BUCKETS];
+    if (bucket_counts[(first_key >> shift) & MASK] == v.size()) {
+      continue;
+    }
+
+    auto sum = std::size_t{0U};
+    for (auto b = std::size_t{0U}; b != BUCKETS; ++b) {
+      auto const count = bucket_counts[b];
+      bucket_counts[b] = sum;
+      sum += count;
+    }
+
+    for (auto const& el : *src) {
+      auto const key = static_cast<std::uint64_t>(get_key(el));
+      (*dst)[bucket_counts[(key >> shift) & MASK]++] = el;
+    }
+    std::swap(src, dst);
+  }
+
+  if (src != &v) {
+    v.swap(tmp);
+  }
+}
+
+}  // namespace cista
@@ -0,0 +1,75 @@
+#pragma once
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>  // _mm_prefetch
+#endif
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+#include "cista/offset_t.h"
+#include "cista/verify.h"
+
+namespace cista {
+
+// Relocation table written with mode::WITH_RELOCATIONS.
+//
+// Layout (appended behind the serialized data, 8 byte aligned):
+//   - std::uint64_t[n]: bitmap, bit i of word w marks the pointer slot at
+//     base + (64 * w + i) * sizeof(void*)
+//   - std::uint64_t: distance from base to the bitmap start
+//   - std::uint64_t: size of the table (without this field)
+//
+// Each marked slot is a raw pointer that holds an offset relative to its own
+// address (or NULLPTR_OFFSET). Pointer slots are aligned, so one bit per
+// slot covers the data from the first pointer on. The bitmap is applied
+// with one ascending pass over the data, without decoding entries.
+// base is relative to the table. This keeps the table independent of the
+// position of the serialized data within the target.
+constexpr auto const RELOCATION_SLOT = sizeof(void*);
+
+// Bitmap words the slot prefetch runs ahead of the pass (one word covers
+// 64 slots = 8 cache lines).
+constexpr auto const RELOCATION_PREFETCH_WORDS = std::size_t{16U};
+
+inline void prefetch_relocation_slots(void const* p) noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  _mm_prefetch(static_cast<char const*>(p), _MM_HINT_T0);
+#elif defined(__GNUC__)
+  __builtin_prefetch(p, 1);
+#else
+  (void)p;
+#endif
+}
+
+struct relocation_bitmap {
+  offset_t base_{0};
+  std::vector<std::uint64_t> words_;
+};
+
+// Sets the bits of all pointer positions. No sorting required.
+inline relocation_bitmap encode_relocations(
+    std::vector<offset_t> const& positions) {
+  auto bitmap = relocation_bitmap{};
+  if (positions.empty()) {
+    return bitmap;
+  }
+
+  auto const [min, max] =
+      std::minmax_element(begin(positions), end(positions));
+  bitmap.base_ = *min;
+  auto const num_slots =
+      static_cast<std::size_t>(*max - *min) / RELOCATION_SLOT + 1U;
+  bitmap.words_.resize((num_slots + 63U) / 64U);
+  for (auto const pos : positions) {
+    auto const distance = static_cast<std::size_t>(pos - bitmap.base_);
+    verify(distance % RELOCATION_SLOT == 0U, "unaligned pointer slot");
+    auto const slot = distance / RELOCATION_SLOT;
+    bitmap.words_[slot / 64U] |= std::uint64_t{1U} << (slot % 64U);
+  }
+  return bitmap;
+}
+
+}  // namespace cista
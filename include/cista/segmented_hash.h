@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cista/endian/conversion.h"
+#include "cista/hash.h"
+#include "cista/parallel_for.h"
+
+namespace cista {
+
+// Integrity hash of mode::WITH_SEGMENTED_INTEGRITY.
+// The data is split into segments of SEGMENT_SIZE bytes (the last one may be
+// shorter) which are hashed independently - and therefore in parallel.
+// The result is the hash over the little endian segment hashes.
+constexpr auto const SEGMENT_SIZE = std::size_t{64U * 1024U};
+
+inline std::size_t num_segments(std::size_t const size) noexcept {
+  return (size + SEGMENT_SIZE - 1U) / SEGMENT_SIZE;
+}
+
+inline hash_t segment_hash(std::string_view const data, std::size_t const i) {
+  return hash(data.substr(i * SEGMENT_SIZE, SEGMENT_SIZE));
+}
+
+inline hash_t combine_segment_hashes(std::vector<hash_t> hashes) {
+  for (auto& h : hashes) {
+    h = convert_endian<mode::NONE>(h);
+  }
+  return hash(std::string_view{reinterpret_cast<char const*>(hashes.data()),
+                               hashes.size() * sizeof(hash_t)});
+}
+
+inline std::vector<hash_t> segment_hashes(
+    std::string_view const data,
+    std::size_t const num_threads = std::thread::hardware_concurrency()) {
+  auto hashes = std::vector<hash_t>(num_segments(data.size()));
+  parallel_for(hashes.size(), num_threads, [&](std::size_t const i) {
+    hashes[i] = segment_hash(data, i);
+  });
+  return hashes;
+}
+
+inline hash_t segmented_hash(
+    std::string_view const data,
+    std::size_t const num_threads = std::thread::hardware_concurrency()) {
+  return combine_segment_hashes(segment_hashes(data, num_threads));
+}
+
+// Segment hashes of a target that grows by appending and is patched at
+// already written positions (pointer fix-ups, header fields).
+// Complete segments are hashed while writing (see completed()). Segments
+// patched after that are marked dirty and rehashed by finish(). This avoids
+// a second pass over the whole output.
+struct segment_tracker {
+  void begin(std::size_t const start) {
+    active_ = true;
+    start_ = start;
+    hashes_.clear();
+    dirty_.clear();
+  }
+
+  void cancel() noexcept { active_ = false; }
+
+  bool is_tracking(std::size_t const start) const noexcept {
+    return active_ && start == start_;
+  }
+
+  // Start of the first segment that is not complete yet.
+  std::size_t open_segment_start() const noexcept {
+    return start_ + hashes_.size() * SEGMENT_SIZE;
+  }
+
+  void completed(hash_t const h) {
+    hashes_.emplace_back(h);
+    dirty_.emplace_back(false);
+  }
+
+  // Hashes all segments completed by growing the target to `size`.
+  // segment(i) has to return the data of segment i.
+  template <typename SegmentFn>
+  void appended(std::size_t const size, SegmentFn&& segment) {
+    if (!active_) {
+      return;
+    }
+    while (open_segment_start() + SEGMENT_SIZE <= size) {
+      completed(hash(segment(hashes_.size())));
+    }
+  }
+
+  // The target grew to `size` without appended(): the data is written in
+  // place afterwards. The new complete segments count as dirty until their
+  // hashes are provided with hashed().
+  void grown(std::size_t const size) {
+    if (!active_ || size < start_) {
+      return;
+    }
+    auto const n = (size - start_) / SEGMENT_SIZE;
+    if (n > hashes_.size()) {
+      hashes_.resize(n);
+      dirty_.resize(n, true);
+    }
+  }
+
+  // Complete segments that lie within [from, to): [first, last).
+  std::pair<std::size_t, std::size_t> segments_within(
+      std::size_t from, std::size_t const to) const noexcept {
+    if (!active_ || to <= start_) {
+      return {0U, 0U};
+    }
+    from = std::max(from, start_);
+    auto const first = (from - start_ + SEGMENT_SIZE - 1U) / SEGMENT_SIZE;
+    auto const last = std::min((to - start_) / SEGMENT_SIZE, hashes_.size());
+    return {first, std::max(first, last)};
+  }
+
+  // Hashes of the segments [first, first + hashes.size()), computed
+  // elsewhere after their data was written.
+  void hashed(std::size_t const first, std::vector<hash_t> const& hashes) {
+    if (!active_) {
+      return;
+    }
+    for (auto i = std::size_t{0U};
+         i != hashes.size() && first + i < hashes_.size(); ++i) {
+      hashes_[first + i] = hashes[i];
+      dirty_[first + i] = false;
+    }
+  }
+
+  void patched(std::size_t const pos, std::size_t const size) {
+    if (!active_ || size == 0U || pos + size <= start_) {
+      return;
+    }
+    auto const first = pos < start_ ? 0U : (pos - start_) / SEGMENT_SIZE;
+    auto const last = (pos + size - 1U - start_) / SEGMENT_SIZE;
+    for (auto i = first; i <= last && i < hashes_.size(); ++i) {
+      dirty_[i] = true;
+    }
+  }
+
+  // Returns the hashes of all segments of a target of `size` bytes.
+  // Segments that are dirty or not complete yet are hashed with segment(i).
+  template <typename SegmentFn>
+  std::vector<hash_t> finish(std::size_t const size, SegmentFn&& segment,
+                             std::size_t const num_threads) {
+    auto const n = num_segments(size - start_);
+    hashes_.resize(n);
+    dirty_.resize(n, true);
+
+    auto todo = std::vector<std::size_t>{};
+    for (auto i = std::size_t{0U}; i != n; ++i) {
+      if (dirty_[i]) {
+        todo.emplace_back(i);
+      }
+    }
+    parallel_for(todo.size(), num_threads, [&](std::size_t const i) {
+      hashes_[todo[i]] = hash(segment(todo[i]));
+    });
+
+    active_ = false;
+    dirty_.clear();
+    return std::move(hashes_);
+  }
+
+  bool active_{false};
+  std::size_t start_{0U};
+  std::vector<hash_t> hashes_;
+  std::vector<bool> dirty_;
+};
+
+// segment_tracker for targets that cannot read back their output cheaply
+// (files): the open segment is kept in memory until it is complete.
+// Only dirty segments are read back in the end.
+struct streamed_segments {
+  void begin(std::size_t const start) {
+    tracker_.begin(start);
+    open_.clear();
+    open_.reserve(SEGMENT_SIZE);
+  }
+
+  void cancel() noexcept { tracker_.cancel(); }
+
+  bool is_tracking(std::size_t const start) const noexcept {
+    return tracker_.is_tracking(start);
+  }
+
+  // Bytes appended to the end of the target (nullptr: zero padding).
+  void appended(void const* ptr, std::size_t size) {
+    if (!tracker_.active_) {
+      return;
+    }
+    auto data = static_cast<char const*>(ptr);
+    while (size != 0U) {
+      auto const n = std::min(size, SEGMENT_SIZE - open_.size());
+      if (data == nullptr) {
+        open_.insert(end(open_), n, '\0');
+      } else {
+        open_.insert(end(open_), data, data + n);
+        data += n;
+      }
+      size -= n;
+      if (open_.size() == SEGMENT_SIZE) {
+        tracker_.completed(hash(std::string_view{open_.data(), open_.size()}));
+        open_.clear();
+      }
+    }
+  }
+
+  // Bytes overwritten at [pos, pos + size).
+  void patched(std::size_t const pos, void const* ptr, std::size_t const size) {
+    if (!tracker_.active_) {
+      return;
+    }
+    tracker_.patched(pos, size);
+    auto const open_start = tracker_.open_segment_start();
+    if (pos + size > open_start) {
+      auto const skip = pos < open_start ? open_start - pos : 0U;
+      std::memcpy(&open_[pos + skip - open_start],
+                  static_cast<char const*>(ptr) + skip, size - skip);
+    }
+  }
+
+  // read(from, size, out) has to read the given range of the target.
+  template <typename ReadFn>
+  std::vector<hash_t> finish(std::size_t const size, ReadFn&& read) {
+    auto const open_start = tracker_.open_segment_start();
+    auto buf = std::vector<char>(SEGMENT_SIZE);
+    return tracker_.finish(
+        size,
+        [&](std::size_t const i) {
+          auto const from = tracker_.start_ + i * SEGMENT_SIZE;
+          if (from == open_start) {
+            return std::string_view{open_.data(), open_.size()};
+          }
+          auto const n = std::min(SEGMENT_SIZE, size - from);
+          read(from, n, buf.data());
+          return std::string_view{buf.data(), n};
+        },
+        1U);
+  }
+
+  segment_tracker tracker_;
+  std::vector<char> open_;
+};
+
+}  // namespace cista
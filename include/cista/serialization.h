@@ -1,24 +1,35 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstring>
+#include <future>
 #include <limits>
-#include <map>
+#include <memory>
 #include <numeric>
 #include <optional>
 #include <set>
+#include <thread>
 #include <vector>
 
 #include "cista/aligned_alloc.h"
+#include "cista/bit_counting.h"
 #include "cista/containers.h"
 #include "cista/decay.h"
 #include "cista/endian/conversion.h"
 #include "cista/hash.h"
 #include "cista/mode.h"
 #include "cista/offset_t.h"
+#include "cista/radix_sort.h"
+#include "cista/relocations.h"
+#include "cista/segmented_hash.h"
 #include "cista/reflection/for_each_field.h"
 #include "cista/serialized_size.h"
 #include "cista/strong.h"
 #include "cista/targets/buf.h"
+#include "cista/targets/dry_run.h"
 #include "cista/targets/file.h"
 #include "cista/type_hash/static_type_hash.h"
 #include "cista/type_hash/type_hash.h"
@@ -55,6 +66,329 @@ offset_t member_offset(T const* t, Member T::*m) {
 // =============================================================================
 // SERIALIZE
 // -----------------------------------------------------------------------------
+// Type graph traits.
+//
+// Cista containers are handled explicitly. Aggregates are reflected field by
+// field, unless a custom serialize() overload exists for them: such types are
+// opaque (to_tuple() might not even work for them, e.g. for bit fields).
+// `Seen` contains all types on the current path to handle recursive types.
+template <typename... T>
+struct type_list {};
+
+struct serialize_probe {};
+
+template <typename T>
+int serialize(serialize_probe&, T const*, offset_t);
+
+template <typename T, typename = void>
+struct has_custom_serialize : std::true_type {};
+
+template <typename T>
+struct has_custom_serialize<
+    T, std::enable_if_t<std::is_same_v<
+           int, decltype(serialize(std::declval<serialize_probe&>(),
+                                   std::declval<T const*>(), offset_t{}))>>>
+    : std::false_type {};
+
+template <typename T>
+constexpr bool has_custom_serialize_v = has_custom_serialize<T>::value;
+
+template <typename T>
+using fields_t = decltype(to_tuple(std::declval<T&>()));
+
+template <typename T, typename... Seen>
+constexpr bool has_non_owning_ptr(T const*, type_list<Seen...>) noexcept;
+
+template <typename T, typename... Seen>
+constexpr bool visit_has_non_owning_ptr(type_list<Seen...>) noexcept {
+  using Type = decay_t<T>;
+  if constexpr ((std::is_same_v<Type, Seen> || ...)) {
+    return false;
+  } else {
+    return has_non_owning_ptr(null<Type>(), type_list<Seen..., Type>{});
+  }
+}
+
+template <typename Tuple, typename... Seen, std::size_t... I>
+constexpr bool any_field_has_non_owning_ptr(
+    type_list<Seen...> const seen, std::index_sequence<I...>) noexcept {
+  return (visit_has_non_owning_ptr<std::tuple_element_t<I, Tuple>>(seen) ||
+          ...);
+}
+
+template <typename T, typename... Seen>
+constexpr bool has_non_owning_ptr(T const*,
+                                  type_list<Seen...> const seen) noexcept {
+  using Type = decay_t<T>;
+  if constexpr (is_pointer_v<Type>) {
+    return true;
+  } else if constexpr (is_indexed_v<Type>) {
+    return visit_has_non_owning_ptr<typename Type::value_type>(seen);
+  } else if constexpr (has_custom_serialize_v<Type>) {
+    return true;  // opaque, also for unions
+  } else if constexpr (std::is_scalar_v<Type> || std::is_union_v<Type>) {
+    return false;
+  } else if constexpr (!to_tuple_works_v<Type>) {
+    return true;
+  } else {
+    using fields = fields_t<Type>;
+    return any_field_has_non_owning_ptr<fields>(
+        seen, std::make_index_sequence<std::tuple_size_v<fields>>());
+  }
+}
+
+template <typename T, template <typename> typename Ptr, bool Indexed,
+          typename TemplateSizeType, typename... Seen>
+constexpr bool has_non_owning_ptr(
+    basic_vector<T, Ptr, Indexed, TemplateSizeType> const*,
+    type_list<Seen...> const seen) noexcept {
+  return visit_has_non_owning_ptr<T>(seen);
+}
+
+template <typename Ptr, typename... Seen>
+constexpr bool has_non_owning_ptr(generic_string<Ptr> const*,
+                                  type_list<Seen...>) noexcept {
+  return false;
+}
+
+template <typename Ptr, typename... Seen>
+constexpr bool has_non_owning_ptr(basic_string<Ptr> const*,
+                                  type_list<Seen...>) noexcept {
+  return false;
+}
+
+template <typename Ptr, typename... Seen>
+constexpr bool has_non_owning_ptr(basic_string_view<Ptr> const*,
+                                  type_list<Seen...>) noexcept {
+  return false;
+}
+
+template <typename T, typename Ptr, typename... Seen>
+constexpr bool has_non_owning_ptr(basic_unique_ptr<T, Ptr> const*,
+                                  type_list<Seen...> const seen) noexcept {
+  return visit_has_non_owning_ptr<T>(seen);
+}
+
+template <typename T, template <typename> typename Ptr, typename GetKey,
+          typename GetValue, typename Hash, typename Eq, std::size_t Width,
+          typename... Seen>
+constexpr bool has_non_owning_ptr(
+    hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq, Width> const*,
+    type_list<Seen...> const seen) noexcept {
+  return visit_has_non_owning_ptr<T>(seen);
+}
+
+template <typename T, typename SizeType, template <typename> typename Vec,
+          std::size_t Log2MaxEntriesPerBucket, typename... Seen>
+constexpr bool has_non_owning_ptr(
+    dynamic_fws_multimap_base<T, SizeType, Vec, Log2MaxEntriesPerBucket> const*,
+    type_list<Seen...> const seen) noexcept {
+  return visit_has_non_owning_ptr<T>(seen);
+}
+
+template <typename T, std::size_t Size, typename... Seen>
+constexpr bool has_non_owning_ptr(array<T, Size> const*,
+                                  type_list<Seen...> const seen) noexcept {
+  return visit_has_non_owning_ptr<T>(seen);
+}
+
+template <std::size_t Size, typename... Seen>
+constexpr bool has_non_owning_ptr(bitset<Size> const*,
+                                  type_list<Seen...>) noexcept {
+  return false;
+}
+
+template <typename A, typename B, typename... Seen>
+constexpr bool has_non_owning_ptr(pair<A, B> const*,
+                                  type_list<Seen...> const seen) noexcept {
+  return visit_has_non_owning_ptr<A>(seen) ||
+         visit_has_non_owning_ptr<B>(seen);
+}
+
+template <typename A, typename B, typename... Seen>
+constexpr bool has_non_owning_ptr(std::pair<A, B> const*,
+                                  type_list<Seen...> const seen) noexcept {
+  return visit_has_non_owning_ptr<A>(seen) ||
+         visit_has_non_owning_ptr<B>(seen);
+}
+
+template <typename... T, typename... Seen>
+constexpr bool has_non_owning_ptr(variant<T...> const*,
+                                  type_list<Seen...> const seen) noexcept {
+  return (visit_has_non_owning_ptr<T>(seen) || ...);
+}
+
+template <typename... T, typename... Seen>
+constexpr bool has_non_owning_ptr(tuple<T...> const*,
+                                  type_list<Seen...> const seen) noexcept {
+  return (visit_has_non_owning_ptr<T>(seen) || ...);
+}
+
+template <typename T, typename... Seen>
+constexpr bool has_non_owning_ptr(optional<T> const*,
+                                  type_list<Seen...> const seen) noexcept {
+  return visit_has_non_owning_ptr<T>(seen);
+}
+
+template <typename T, typename Tag, typename... Seen>
+constexpr bool has_non_owning_ptr(strong<T, Tag> const*,
+                                  type_list<Seen...> const seen) noexcept {
+  return visit_has_non_owning_ptr<T>(seen);
+}
+
+template <typename Rep, typename Period, typename... Seen>
+constexpr bool has_non_owning_ptr(std::chrono::duration<Rep, Period> const*,
+                                  type_list<Seen...>) noexcept {
+  return false;
+}
+
+template <typename Clock, typename Dur, typename... Seen>
+constexpr bool has_non_owning_ptr(std::chrono::time_point<Clock, Dur> const*,
+                                  type_list<Seen...>) noexcept {
+  return false;
+}
+
+// True if an object of type T can contain a pointer that does not own its
+// target (raw::ptr, offset::ptr). Only then pointers need to be tracked.
+template <typename T>
+constexpr bool has_non_owning_ptr_v =
+    visit_has_non_owning_ptr<T>(type_list<>{});
+
+template <typename T>
+constexpr bool is_self_contained(T const*, type_list<>) noexcept;
+
+template <typename T>
+constexpr bool visit_is_self_contained() noexcept {
+  return is_self_contained(null<decay_t<T>>(), type_list<>{});
+}
+
+template <typename Tuple, std::size_t... I>
+constexpr bool all_fields_self_contained(std::index_sequence<I...>) noexcept {
+  return (visit_is_self_contained<std::tuple_element_t<I, Tuple>>() && ...);
+}
+
+template <typename T>
+constexpr bool is_self_contained(T const*, type_list<>) noexcept {
+  using Type = decay_t<T>;
+  if constexpr (is_pointer_v<Type> || is_indexed_v<Type>) {
+    return false;
+  } else if constexpr (has_custom_serialize_v<Type>) {
+    return false;  // opaque, also for unions
+  } else if constexpr (std::is_scalar_v<Type> || std::is_union_v<Type>) {
+    return true;
+  } else if constexpr (!to_tuple_works_v<Type>) {
+    return false;
+  } else {
+    using fields = fields_t<Type>;
+    return all_fields_self_contained<fields>(
+        std::make_index_sequence<std::tuple_size_v<fields>>());
+  }
+}
+
+template <typename T, std::size_t Size>
+constexpr bool is_self_contained(array<T, Size> const*, type_list<>) noexcept {
+  return visit_is_self_contained<T>();
+}
+
+template <std::size_t Size>
+constexpr bool is_self_contained(bitset<Size> const*, type_list<>) noexcept {
+  return true;
+}
+
+template <typename A, typename B>
+constexpr bool is_self_contained(pair<A, B> const*, type_list<>) noexcept {
+  return visit_is_self_contained<A>() && visit_is_self_contained<B>();
+}
+
+template <typename A, typename B>
+constexpr bool is_self_contained(std::pair<A, B> const*,
+                                 type_list<>) noexcept {
+  return visit_is_self_contained<A>() && visit_is_self_contained<B>();
+}
+
+template <typename... T>
+constexpr bool is_self_contained(variant<T...> const*, type_list<>) noexcept {
+  return (visit_is_self_contained<T>() && ...);
+}
+
+template <typename... T>
+constexpr bool is_self_contained(tuple<T...> const*, type_list<>) noexcept {
+  return (visit_is_self_contained<T>() && ...);
+}
+
+template <typename T>
+constexpr bool is_self_contained(optional<T> const*, type_list<>) noexcept {
+  return visit_is_self_contained<T>();
+}
+
+template <typename T, typename Tag>
+constexpr bool is_self_contained(strong<T, Tag> const*, type_list<>) noexcept {
+  return visit_is_self_contained<T>();
+}
+
+template <typename Rep, typename Period>
+constexpr bool is_self_contained(std::chrono::duration<Rep, Period> const*,
+                                 type_list<>) noexcept {
+  return true;
+}
+
+template <typename Clock, typename Dur>
+constexpr bool is_self_contained(std::chrono::time_point<Clock, Dur> const*,
+                                 type_list<>) noexcept {
+  return true;
+}
+
+// True if serialize() for T would only re-write the bytes of the object
+// itself unchanged: no data outside of the object, no pointers, no offsets
+// to record and no endian conversion. Copying the object representation
+// is then all there is to do (e.g. for the element block of a vector).
+template <typename T, mode Mode>
+constexpr bool is_trivially_serializable_v =
+    !endian_conversion_necessary<Mode>() && visit_is_self_contained<T>();
+
+// Compile-time list of the fields of an aggregate that need to be visited.
+// Fields for which there is nothing to do are not even instantiated.
+template <std::size_t N>
+struct field_plan {
+  std::array<std::size_t, (N == 0U ? 1U : N)> indices_{};
+  std::size_t size_{0U};
+};
+
+template <std::size_t N>
+constexpr field_plan<N> make_field_plan(
+    std::array<bool, N> const& visit) noexcept {
+  auto plan = field_plan<N>{};
+  for (auto i = std::size_t{0U}; i != N; ++i) {
+    if (visit[i]) {
+      plan.indices_[plan.size_++] = i;
+    }
+  }
+  return plan;
+}
+
+template <typename Plan, std::size_t... J>
+constexpr auto plan_indices(std::index_sequence<J...>) noexcept {
+  return std::index_sequence<Plan::value.indices_[J]...>{};
+}
+
+template <typename Plan>
+using plan_indices_t =
+    decltype(plan_indices<Plan>(std::make_index_sequence<Plan::value.size_>()));
+
+template <typename Fields, mode Mode, std::size_t... I>
+constexpr auto make_serialize_plan(std::index_sequence<I...>) noexcept {
+  return make_field_plan(std::array<bool, sizeof...(I)>{
+      !is_trivially_serializable_v<decay_t<std::tuple_element_t<I, Fields>>,
+                                   Mode>...});
+}
+
+template <typename T, mode Mode>
+struct serialize_plan {
+  using fields = fields_t<T>;
+  static constexpr auto const value = make_serialize_plan<fields, Mode>(
+      std::make_index_sequence<std::tuple_size_v<fields>>());
+};
+
 struct pending_offset {
   void const* origin_ptr_;
   offset_t pos_;
@@ -78,16 +412,25 @@ struct vector_range {
   std::size_t size_;
 };
 
-template <typename Target, mode Mode>
+struct no_tracking {};
+
+// Positions of raw pointers (only with mode::WITH_RELOCATIONS).
+template <mode Mode>
+using relocations_t =
+    std::conditional_t<is_mode_enabled(Mode, mode::WITH_RELOCATIONS),
+                       std::vector<offset_t>, no_tracking>;
+
+// Pointer tracking (offsets, vector ranges, pending pointers) is only
+// compiled in if the serialized type graph can contain non-owning pointers.
+template <typename Target, mode Mode, bool TrackPointers = true>
 struct serialization_context {
   static constexpr auto const MODE = Mode;
 
-  explicit serialization_context(Target& t) : t_{t} {}
+  template <typename T>
+  using tracked_t =
+      std::conditional_t<TrackPointers, std::vector<T>, no_tracking>;
 
-  static bool compare(std::pair<void const*, vector_range> const& a,
-                      std::pair<void const*, vector_range> const& b) noexcept {
-    return a.first < b.first;
-  }
+  explicit serialization_context(Target& t) : t_{t} {}
 
   offset_t write(void const* ptr, std::size_t const size,
                  std::size_t const alignment = 0) {
@@ -100,63 +443,224 @@ struct serialization_context {
   }
 
   template <typename T>
-  bool resolve_pointer(offset_ptr<T> const& ptr, offset_t const pos,
-                       bool const add_pending = true) {
-    return resolve_pointer(ptr.get(), pos, add_pending);
+  void resolve_pointer(offset_ptr<T> const& ptr, offset_t const pos) {
+    resolve_pointer(ptr.get(), pos);
   }
 
+  // Pointers into already known vector ranges are resolved directly.
+  // Everything else is collected and resolved in one sort-merge pass at the
+  // end (see resolve_pending).
   template <typename Ptr>
-  bool resolve_pointer(Ptr ptr, offset_t const pos,
-                       bool const add_pending = true) {
-    if (std::is_same_v<decay_t<remove_pointer_t<Ptr>>, void> && add_pending) {
+  void resolve_pointer(Ptr ptr, offset_t const pos) {
+    static_assert(TrackPointers || sizeof(Ptr) == 0U,
+                  "pointer in a type graph without non-owning pointers");
+
+    if (std::is_same_v<decay_t<remove_pointer_t<Ptr>>, void> ||
+        ptr == nullptr) {
       write(pos, convert_endian<MODE>(NULLPTR_OFFSET));
-      return true;
+      return;
     }
-    if (ptr == nullptr) {
-      write(pos, convert_endian<MODE>(NULLPTR_OFFSET));
-      return true;
+
+    auto const origin = static_cast<void const*>(ptr_cast(ptr));
+    auto const sorted_end = begin(vector_ranges_) + num_sorted_ranges_;
+    auto const it = std::upper_bound(
+        begin(vector_ranges_), sorted_end, origin,
+        [](void const* a, auto const& b) { return a < b.first; });
+    if (it != begin(vector_ranges_)) {
+      auto const& [range_begin, range] = *std::prev(it);
+      if (range.contains(range_begin, origin)) {
+        write(pos, convert_endian<MODE>(range.offset_of(range_begin, origin) -
+                                        pos));
+        return;
+      }
+    }
+
+    pending_.emplace_back(pending_offset{origin, pos});
+  }
+
+  template <typename T>
+  void add_relocation(T* const*, offset_t const pos) {
+    if constexpr (is_mode_enabled(MODE, mode::WITH_RELOCATIONS)) {
+      relocations_.emplace_back(pos);
+    } else {
+      CISTA_UNUSED_PARAM(pos)
+    }
+  }
+
+  template <typename T>
+  void add_relocation(offset_ptr<T> const*, offset_t const) {}
+
+  void add_offset(void const* origin, offset_t const pos) {
+    if constexpr (TrackPointers) {
+      offsets_.emplace_back(origin, pos);
+    } else {
+      CISTA_UNUSED_PARAM(origin)
+      CISTA_UNUSED_PARAM(pos)
     }
-    if (auto const it = offsets_.find(ptr_cast(ptr)); it != end(offsets_)) {
-      write(pos, convert_endian<MODE>(it->second - pos));
-      return true;
+  }
+
+  // Ranges are kept in a sorted flat array for direct lookups as long as this
+  // is cheap (appending or few ranges). Others are only known to the final
+  // sort-merge pass.
+  void add_vector_range(void const* begin, offset_t const start,
+                        std::size_t const size) {
+    constexpr auto const MAX_SORTED_INSERT = std::size_t{4096U};
+    if constexpr (TrackPointers) {
+      auto const entry = std::pair{begin, vector_range{start, size}};
+      if (num_sorted_ranges_ != vector_ranges_.size()) {
+        vector_ranges_.emplace_back(entry);
+      } else if (vector_ranges_.empty() ||
+                 vector_ranges_.back().first < begin) {
+        vector_ranges_.emplace_back(entry);
+        ++num_sorted_ranges_;
+      } else if (vector_ranges_.size() < MAX_SORTED_INSERT) {
+        vector_ranges_.insert(
+            std::upper_bound(
+                std::begin(vector_ranges_), std::end(vector_ranges_), begin,
+                [](void const* a, auto const& b) { return a < b.first; }),
+            entry);
+        ++num_sorted_ranges_;
+      } else {
+        vector_ranges_.emplace_back(entry);
+      }
+    } else {
+      CISTA_UNUSED_PARAM(begin)
+      CISTA_UNUSED_PARAM(start)
+      CISTA_UNUSED_PARAM(size)
     }
-    if (auto const offset = resolve_vector_range_ptr(ptr); offset.has_value()) {
-      write(pos, convert_endian<MODE>(*offset - pos));
-      return true;
+  }
+
+  // Takes over the bookkeeping of another context that wrote to a different
+  // region of the same output.
+  template <typename OtherTarget>
+  void merge(serialization_context<OtherTarget, Mode, TrackPointers>& o) {
+    auto const append = [](auto& to, auto& from) {
+      to.insert(end(to), std::make_move_iterator(begin(from)),
+                std::make_move_iterator(end(from)));
+      from.clear();
+    };
+    if constexpr (TrackPointers) {
+      append(offsets_, o.offsets_);
+      append(vector_ranges_, o.vector_ranges_);
+      append(pending_, o.pending_);
     }
-    if (add_pending) {
-      write(pos, convert_endian<MODE>(NULLPTR_OFFSET));
-      pending_.emplace_back(pending_offset{ptr_cast(ptr), pos});
-      return true;
+    if constexpr (is_mode_enabled(MODE, mode::WITH_RELOCATIONS)) {
+      append(relocations_, o.relocations_);
     }
-    return false;
+    CISTA_UNUSED_PARAM(append)
   }
 
-  template <typename Ptr>
-  std::optional<offset_t> resolve_vector_range_ptr(Ptr ptr) {
-    if (vector_ranges_.empty()) {
-      return std::nullopt;
+  void resolve_pending() {
+    if constexpr (TrackPointers) {
+      sort_merge_pending();
     }
-    auto const vec_it = vector_ranges_.upper_bound(ptr);
-    if (vec_it == begin(vector_ranges_)) {
-      return std::nullopt;
+  }
+
+  void sort_merge_pending() {
+    auto const address = [](void const* ptr) {
+      return reinterpret_cast<std::uintptr_t>(ptr);
+    };
+    radix_sort(offsets_, [&](auto const& o) { return address(o.first); });
+    radix_sort(vector_ranges_,
+               [&](auto const& r) { return address(r.first); });
+    radix_sort(pending_, [&](pending_offset const& p) {
+      return address(p.origin_ptr_);
+    });
+
+    auto offset_it = begin(offsets_);
+    auto range_it = begin(vector_ranges_);
+    for (auto const& p : pending_) {
+      while (offset_it != end(offsets_) && offset_it->first < p.origin_ptr_) {
+        ++offset_it;
+      }
+      while (range_it != end(vector_ranges_) &&
+             std::next(range_it) != end(vector_ranges_) &&
+             std::next(range_it)->first <= p.origin_ptr_) {
+        ++range_it;
+      }
+
+      if (offset_it != end(offsets_) && offset_it->first == p.origin_ptr_) {
+        write(p.pos_, convert_endian<MODE>(offset_it->second - p.pos_));
+      } else if (range_it != end(vector_ranges_) &&
+                 range_it->second.contains(range_it->first, p.origin_ptr_)) {
+        write(p.pos_,
+              convert_endian<MODE>(
+                  range_it->second.offset_of(range_it->first, p.origin_ptr_) -
+                  p.pos_));
+      } else {
+        printf("warning: dangling pointer at %" PRI_O " (origin=%p)\n", p.pos_,
+               p.origin_ptr_);
+        write(p.pos_, convert_endian<MODE>(NULLPTR_OFFSET));
+      }
     }
-    auto const pred = std::prev(vec_it);
-    return pred->second.contains(pred->first, ptr)
-               ? std::make_optional(pred->second.offset_of(pred->first, ptr))
-               : std::nullopt;
   }
 
   std::uint64_t checksum(offset_t const from) const noexcept {
     return t_.checksum(from);
   }
 
-  cista::raw::hash_map<void const*, offset_t> offsets_;
-  std::map<void const*, vector_range> vector_ranges_;
-  std::vector<pending_offset> pending_;
+  std::vector<hash_t> segment_hashes(offset_t const from) const {
+    return t_.segment_hashes(from);
+  }
+
+  tracked_t<std::pair<void const*, offset_t>> offsets_;
+  tracked_t<std::pair<void const*, vector_range>> vector_ranges_;
+  std::size_t num_sorted_ranges_{0U};
+  tracked_t<pending_offset> pending_;
+  relocations_t<Mode> relocations_;
   Target& t_;
 };
 
+template <mode Mode>
+struct sizing_context {
+  static constexpr auto const MODE = Mode;
+
+  explicit sizing_context(std::size_t const start) : t_{start} {}
+
+  offset_t write(void const* ptr, std::size_t const size,
+                 std::size_t const alignment = 0) {
+    return t_.write(ptr, size, alignment);
+  }
+
+  template <typename T>
+  void write(offset_t const, T const&) noexcept {}
+
+  template <typename Ptr>
+  void resolve_pointer(Ptr const&, offset_t const) noexcept {}
+
+  template <typename T>
+  void add_relocation(T* const*, offset_t const pos) {
+    if constexpr (is_mode_enabled(MODE, mode::WITH_RELOCATIONS)) {
+      relocations_.emplace_back(pos);
+    } else {
+      CISTA_UNUSED_PARAM(pos)
+    }
+  }
+
+  template <typename T>
+  void add_relocation(offset_ptr<T> const*, offset_t const) noexcept {}
+
+  void add_offset(void const*, offset_t const) noexcept {}
+
+  void add_vector_range(void const*, offset_t const,
+                        std::size_t const) noexcept {}
+
+  relocations_t<Mode> relocations_;
+  dry_run t_;
+};
+
+template <typename Ctx, typename T, std::size_t... I>
+void serialize_fields(Ctx& c, T const* origin, offset_t const pos,
+                      std::index_sequence<I...>) {
+  auto const fields = to_ptr_tuple(*origin);
+  CISTA_UNUSED_PARAM(fields)
+  (serialize(c, std::get<I>(fields),
+             pos + static_cast<offset_t>(
+                       reinterpret_cast<intptr_t>(std::get<I>(fields)) -
+                       reinterpret_cast<intptr_t>(origin))),
+   ...);
+}
+
 template <typename Ctx, typename T>
 void serialize(Ctx& c, T const* origin, offset_t const pos) {
   using Type = decay_t<T>;
@@ -164,18 +668,19 @@ void serialize(Ctx& c, T const* origin, offset_t const pos) {
     static_assert(std::is_standard_layout_v<Type> &&
                   std::is_trivially_copyable_v<Type>);
   } else if constexpr (is_pointer_v<Type>) {
+    c.add_relocation(origin, pos);
     c.resolve_pointer(*origin, pos);
   } else if constexpr (is_indexed_v<Type>) {
-    c.offsets_.emplace(origin, pos);
+    c.add_offset(origin, pos);
     serialize(c, static_cast<typename Type::value_type const*>(origin), pos);
+  } else if constexpr (is_trivially_serializable_v<Type, Ctx::MODE>) {
+    CISTA_UNUSED_PARAM(c)
+    CISTA_UNUSED_PARAM(origin)
+    CISTA_UNUSED_PARAM(pos)
   } else if constexpr (!std::is_scalar_v<Type>) {
     static_assert(to_tuple_works_v<Type>, "Please implement custom serializer");
-    for_each_ptr_field(*origin, [&](auto& member) {
-      auto const member_offset =
-          static_cast<offset_t>(reinterpret_cast<intptr_t>(member) -
-                                reinterpret_cast<intptr_t>(origin));
-      serialize(c, member, pos + member_offset);
-    });
+    serialize_fields(c, origin, pos,
+                     plan_indices_t<serialize_plan<Type, Ctx::MODE>>{});
   } else if constexpr (std::numeric_limits<Type>::is_integer) {
     c.write(pos, convert_endian<Ctx::MODE>(*origin));
   } else {
@@ -202,6 +707,7 @@ void serialize(Ctx& c,
               start == NULLPTR_OFFSET
                   ? start
                   : start - cista_member_offset(Type, el_) - pos));
+  c.add_relocation(&origin->el_, pos + cista_member_offset(Type, el_));
   c.write(pos + cista_member_offset(Type, allocated_size_),
           convert_endian<Ctx::MODE>(origin->used_size_));
   c.write(pos + cista_member_offset(Type, used_size_),
@@ -210,15 +716,17 @@ void serialize(Ctx& c,
 
   if constexpr (Indexed) {
     if (origin->el_ != nullptr) {
-      c.vector_ranges_.emplace(origin->el_, vector_range{start, size});
+      c.add_vector_range(origin->el_, start, size);
     }
   }
 
-  if (origin->el_ != nullptr) {
-    auto i = 0U;
-    for (auto it = start; it != start + static_cast<offset_t>(size);
-         it += serialized_size<T>()) {
-      serialize(c, static_cast<T const*>(origin->el_ + i++), it);
+  if constexpr (!is_trivially_serializable_v<T, Ctx::MODE>) {
+    if (origin->el_ != nullptr) {
+      auto i = 0U;
+      for (auto it = start; it != start + static_cast<offset_t>(size);
+           it += serialized_size<T>()) {
+        serialize(c, static_cast<T const*>(origin->el_ + i++), it);
+      }
     }
   }
 }
@@ -239,6 +747,7 @@ void serialize(Ctx& c, generic_string<Ptr> const* origin, offset_t const pos) {
               start == NULLPTR_OFFSET
                   ? start
                   : start - cista_member_offset(Type, h_.ptr_) - pos));
+  c.add_relocation(&origin->h_.ptr_, pos + cista_member_offset(Type, h_.ptr_));
   c.write(pos + cista_member_offset(Type, h_.size_),
           convert_endian<Ctx::MODE>(origin->h_.size_));
   c.write(pos + cista_member_offset(Type, h_.self_allocated_), false);
@@ -286,20 +795,23 @@ void serialize(Ctx& c, basic_unique_ptr<T, Ptr> const* origin,
               start == NULLPTR_OFFSET
                   ? start
                   : start - cista_member_offset(Type, el_) - pos));
+  c.add_relocation(&origin->el_, pos + cista_member_offset(Type, el_));
   c.write(pos + cista_member_offset(Type, self_allocated_), false);
 
   if (origin->el_ != nullptr) {
-    c.offsets_[origin->el_] = start;
+    c.add_offset(origin->el_, start);
     serialize(c, ptr_cast(origin->el_), start);
   }
 }
 
 template <typename Ctx, typename T, template <typename> typename Ptr,
-          typename GetKey, typename GetValue, typename Hash, typename Eq>
-void serialize(Ctx& c,
-               hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq> const* origin,
-               offset_t const pos) {
-  using Type = hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq>;
+          typename GetKey, typename GetValue, typename Hash, typename Eq,
+          std::size_t Width>
+void serialize(
+    Ctx& c,
+    hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq, Width> const* origin,
+    offset_t const pos) {
+  using Type = hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq, Width>;
 
   auto const start =
       origin->entries_ == nullptr
@@ -327,6 +839,9 @@ void serialize(Ctx& c,
               ctrl_start == NULLPTR_OFFSET
                   ? ctrl_start
                   : ctrl_start - cista_member_offset(Type, ctrl_) - pos));
+  c.add_relocation(&origin->entries_,
+                   pos + cista_member_offset(Type, entries_));
+  c.add_relocation(&origin->ctrl_, pos + cista_member_offset(Type, ctrl_));
 
   c.write(pos + cista_member_offset(Type, self_allocated_), false);
 
@@ -337,14 +852,16 @@ void serialize(Ctx& c,
   c.write(pos + cista_member_offset(Type, growth_left_),
           convert_endian<Ctx::MODE>(origin->growth_left_));
 
-  if (origin->entries_ != nullptr) {
-    auto i = 0u;
-    for (auto it = start;
-         it != start + static_cast<offset_t>(origin->capacity_ *
-                                             serialized_size<T>());
-         it += serialized_size<T>(), ++i) {
-      if (Type::is_full(origin->ctrl_[i])) {
-        serialize(c, static_cast<T*>(origin->entries_ + i), it);
+  if constexpr (!is_trivially_serializable_v<T, Ctx::MODE>) {
+    if (origin->entries_ != nullptr) {
+      auto i = 0u;
+      for (auto it = start;
+           it != start + static_cast<offset_t>(origin->capacity_ *
+                                               serialized_size<T>());
+           it += serialized_size<T>(), ++i) {
+        if (Type::is_full(origin->ctrl_[i])) {
+          serialize(c, static_cast<T*>(origin->entries_ + i), it);
+        }
       }
     }
   }
@@ -371,11 +888,17 @@ void serialize(Ctx& c, bitset<Size> const* origin, offset_t const pos) {
 
 template <typename Ctx, typename T, std::size_t Size>
 void serialize(Ctx& c, array<T, Size> const* origin, offset_t const pos) {
-  auto const size =
-      static_cast<offset_t>(serialized_size<T>() * origin->size());
-  auto i = 0U;
-  for (auto it = pos; it != pos + size; it += serialized_size<T>()) {
-    serialize(c, &(*origin)[i++], it);
+  if constexpr (is_trivially_serializable_v<T, Ctx::MODE>) {
+    CISTA_UNUSED_PARAM(c)
+    CISTA_UNUSED_PARAM(origin)
+    CISTA_UNUSED_PARAM(pos)
+  } else {
+    auto const size =
+        static_cast<offset_t>(serialized_size<T>() * origin->size());
+    auto i = 0U;
+    for (auto it = pos; it != pos + size; it += serialized_size<T>()) {
+      serialize(c, &(*origin)[i++], it);
+    }
   }
 }
 
@@ -443,16 +966,110 @@ constexpr offset_t integrity_start(mode const m) noexcept {
 constexpr offset_t data_start(mode const m) noexcept {
   auto start = integrity_start(m);
   if (is_mode_enabled(m, mode::WITH_INTEGRITY) ||
+      is_mode_enabled(m, mode::WITH_SEGMENTED_INTEGRITY) ||
+      is_mode_enabled(m, mode::WITH_BLOCK_INTEGRITY) ||
       is_mode_enabled(m, mode::SKIP_INTEGRITY)) {
     start += sizeof(std::uint64_t);
   }
   return start;
 }
 
-template <mode const Mode = mode::NONE, typename Target, typename T>
-void serialize(Target& t, T& value) {
-  serialization_context<Target, Mode> c{t};
+// Appends the relocation table (see relocations.h) to the target.
+template <typename Ctx>
+void write_relocations(Ctx& c) {
+  constexpr auto const WORD = sizeof(std::uint64_t);
+  auto const bitmap = encode_relocations(c.relocations_);
+  auto const num_words = bitmap.words_.size();
+  auto const table_start =
+      num_words == 0U
+          ? offset_t{0}
+          : c.write(bitmap.words_.data(), num_words * WORD, WORD);
+  auto const distance =
+      num_words == 0U ? std::uint64_t{0U}
+                      : static_cast<std::uint64_t>(table_start - bitmap.base_);
+  c.write(&distance, sizeof(distance), WORD);
+  auto const table_size = static_cast<std::uint64_t>((num_words + 1U) * WORD);
+  c.write(&table_size, sizeof(table_size));
+}
+
+// Appends the block table (see block_integrity) to the target and stores
+// the hash over all block hashes in the integrity slot of the header.
+template <typename Ctx>
+void write_block_table(Ctx& c, offset_t const integrity_offset) {
+  auto const hashes = c.segment_hashes(integrity_offset +
+                                       static_cast<offset_t>(sizeof(hash_t)));
+  auto table = std::vector<hash_t>{};
+  table.reserve(hashes.size() + 1U);
+  for (auto const h : hashes) {
+    table.emplace_back(convert_endian<Ctx::MODE>(h));
+  }
+  table.emplace_back(
+      convert_endian<Ctx::MODE>(static_cast<hash_t>(hashes.size())));
+  c.write(table.data(), table.size() * sizeof(hash_t));
+  c.write(integrity_offset,
+          convert_endian<Ctx::MODE>(combine_segment_hashes(hashes)));
+}
+
+template <typename Target, typename = void>
+struct has_reserve : std::false_type {};
+
+template <typename Target>
+struct has_reserve<Target, std::void_t<decltype(std::declval<Target&>().reserve(
+                               std::declval<std::size_t>()))>>
+    : std::true_type {};
+
+template <typename Target>
+constexpr bool has_reserve_v = has_reserve<Target>::value;
+
+template <typename Target, typename = void>
+struct has_track_segments : std::false_type {};
+
+template <typename Target>
+struct has_track_segments<Target,
+                          std::void_t<decltype(std::declval<Target&>()
+                                                   .track_segments(
+                                                       offset_t{}))>>
+    : std::true_type {};
+
+template <typename Target>
+constexpr bool has_track_segments_v = has_track_segments<Target>::value;
 
+// Exact number of bytes serialize<Mode>(t, value) appends to a target that
+// currently holds `start` bytes (incl. header and alignment padding).
+// Pointers only patch already written bytes, so the traversal of the first
+// pass is sufficient: no pointer bookkeeping is required here.
+template <mode const Mode = mode::NONE, typename T>
+std::size_t serialized_size_of(T const& value, std::size_t const start = 0U) {
+  auto header_size = std::size_t{0U};
+  if constexpr (is_mode_enabled(Mode, mode::WITH_VERSION) ||
+                is_mode_enabled(Mode, mode::WITH_STATIC_VERSION)) {
+    header_size += sizeof(hash_t);
+  }
+  if constexpr (is_mode_enabled(Mode, mode::WITH_INTEGRITY) ||
+                is_mode_enabled(Mode, mode::WITH_SEGMENTED_INTEGRITY) ||
+                is_mode_enabled(Mode, mode::WITH_BLOCK_INTEGRITY)) {
+    header_size += sizeof(hash_t);
+  }
+
+  sizing_context<Mode> c{start + header_size};
+  serialize(c, &value,
+            c.write(&value, serialized_size<T>(),
+                    std::alignment_of_v<decay_t<decltype(value)>>));
+  if constexpr (is_mode_enabled(Mode, mode::WITH_RELOCATIONS)) {
+    write_relocations(c);
+  }
+  if constexpr (is_mode_enabled(Mode, mode::WITH_BLOCK_INTEGRITY)) {
+    auto const num_blocks = num_segments(c.t_.size() - start - header_size);
+    c.write(nullptr, (num_blocks + 1U) * sizeof(hash_t));
+  }
+  return c.t_.size() - start;
+}
+
+// Writes version and integrity placeholder (depending on the mode).
+// Returns the position of the integrity hash.
+template <typename T, typename Ctx>
+offset_t write_header(Ctx& c) {
+  constexpr auto const Mode = Ctx::MODE;
   if constexpr (is_mode_enabled(Mode, mode::WITH_VERSION) ||
                 is_mode_enabled(Mode, mode::WITH_STATIC_VERSION)) {
     static_assert(is_mode_enabled(Mode, mode::WITH_VERSION) ^
@@ -469,30 +1086,81 @@ void serialize(Target& t, T& value) {
     }
   }
 
+  static_assert(
+      static_cast<int>(is_mode_enabled(Mode, mode::WITH_INTEGRITY)) +
+              static_cast<int>(
+                  is_mode_enabled(Mode, mode::WITH_SEGMENTED_INTEGRITY)) +
+              static_cast<int>(
+                  is_mode_enabled(Mode, mode::WITH_BLOCK_INTEGRITY)) <=
+          1,
+      "WITH_INTEGRITY, WITH_SEGMENTED_INTEGRITY and WITH_BLOCK_INTEGRITY "
+      "cannot be combined");
+
   auto integrity_offset = offset_t{0};
-  if constexpr (is_mode_enabled(Mode, mode::WITH_INTEGRITY)) {
+  if constexpr (is_mode_enabled(Mode, mode::WITH_INTEGRITY) ||
+                is_mode_enabled(Mode, mode::WITH_SEGMENTED_INTEGRITY) ||
+                is_mode_enabled(Mode, mode::WITH_BLOCK_INTEGRITY)) {
     auto const h = hash_t{};
     integrity_offset = c.write(&h, sizeof(h));
   }
 
-  serialize(c, &value,
-            c.write(&value, serialized_size<T>(),
-                    std::alignment_of_v<decay_t<decltype(value)>>));
+  // Segment hashes can be computed while writing.
+  // WITH_INTEGRITY hashes everything in one chain: it needs a second pass.
+  if constexpr ((is_mode_enabled(Mode, mode::WITH_SEGMENTED_INTEGRITY) ||
+                 is_mode_enabled(Mode, mode::WITH_BLOCK_INTEGRITY)) &&
+                has_track_segments_v<decay_t<decltype(c.t_)>>) {
+    c.t_.track_segments(integrity_offset +
+                        static_cast<offset_t>(sizeof(hash_t)));
+  }
+  return integrity_offset;
+}
 
-  for (auto& p : c.pending_) {
-    if (!c.resolve_pointer(p.origin_ptr_, p.pos_, false)) {
-      printf("warning: dangling pointer at %" PRI_O " (origin=%p)\n", p.pos_,
-             p.origin_ptr_);
-    }
+// Resolves pending pointers, writes the relocation table and the checksum.
+template <typename Ctx>
+void finish_serialization(Ctx& c, offset_t const integrity_offset) {
+  constexpr auto const Mode = Ctx::MODE;
+
+  c.resolve_pending();
+
+  if constexpr (is_mode_enabled(Mode, mode::WITH_RELOCATIONS)) {
+    static_assert(!endian_conversion_necessary<Mode>(),
+                  "relocations require native byte order");
+    write_relocations(c);
   }
 
   if constexpr (is_mode_enabled(Mode, mode::WITH_INTEGRITY)) {
     auto const csum =
         c.checksum(integrity_offset + static_cast<offset_t>(sizeof(hash_t)));
     c.write(integrity_offset, convert_endian<Mode>(csum));
+  } else if constexpr (is_mode_enabled(Mode,
+                                       mode::WITH_SEGMENTED_INTEGRITY)) {
+    auto const csum = combine_segment_hashes(c.segment_hashes(
+        integrity_offset + static_cast<offset_t>(sizeof(hash_t))));
+    c.write(integrity_offset, convert_endian<Mode>(csum));
+  } else if constexpr (is_mode_enabled(Mode, mode::WITH_BLOCK_INTEGRITY)) {
+    write_block_table(c, integrity_offset);
+  } else {
+    CISTA_UNUSED_PARAM(integrity_offset)
   }
 }
 
+template <mode const Mode = mode::NONE, typename Target, typename T>
+void serialize(Target& t, T& value) {
+  if constexpr (has_reserve_v<Target>) {
+    t.reserve(t.size() + serialized_size_of<Mode>(value, t.size()));
+  }
+
+  serialization_context<Target, Mode, has_non_owning_ptr_v<decay_t<T>>> c{t};
+
+  auto const integrity_offset = write_header<T>(c);
+
+  serialize(c, &value,
+            c.write(&value, serialized_size<T>(),
+                    std::alignment_of_v<decay_t<decltype(value)>>));
+
+  finish_serialization(c, integrity_offset);
+}
+
 template <mode const Mode = mode::NONE, typename T>
 byte_buf serialize(T& el) {
   auto b = buf{};
@@ -635,6 +1303,162 @@ struct deep_check_context : public deserialization_context<Mode> {
   std::set<std::pair<hash_t, void const*>> mutable checked_;
 };
 
+// Lazy verification of data written with mode::WITH_BLOCK_INTEGRITY.
+//
+// Layout (appended behind the serialized data and the relocation table):
+//   - hash_t[n]: hashes of the SEGMENT_SIZE blocks of the data
+//   - std::uint64_t: n
+// The integrity slot of the header holds combine_segment_hashes() of the
+// table. Verifying the table only reads the table: each block is verified
+// the first time it is checked. Checks may run concurrently.
+struct block_integrity {
+  block_integrity(std::uint8_t const* data, std::uint8_t const* data_end,
+                  std::vector<hash_t> table)
+      : data_{data},
+        size_{static_cast<std::size_t>(data_end - data)},
+        table_{std::move(table)},
+        verified_{std::make_unique<std::atomic_bool[]>(table_.size())} {
+    verify(table_.size() == num_segments(size_), "invalid block table size");
+  }
+
+  // Verifies all blocks overlapping [ptr, ptr + size).
+  void check(void const* ptr, std::size_t const size) {
+    if (size == 0U) {
+      return;
+    }
+    auto const p = static_cast<std::uint8_t const*>(ptr);
+    verify(p >= data_ && size <= size_ &&
+               static_cast<std::size_t>(p - data_) <= size_ - size,
+           "block integrity: range out of bounds");
+    auto const offset = static_cast<std::size_t>(p - data_);
+    auto const last = (offset + size - 1U) / SEGMENT_SIZE;
+    for (auto i = offset / SEGMENT_SIZE; i <= last; ++i) {
+      check_block(i);
+    }
+  }
+
+  void check_block(std::size_t const i) {
+    if (verified_[i].load(std::memory_order_acquire)) {
+      return;
+    }
+    verify(segment_hash(std::string_view{reinterpret_cast<char const*>(data_),
+                                         size_},
+                        i) == table_[i],
+           "block integrity: invalid block checksum");
+    verified_[i].store(true, std::memory_order_release);
+  }
+
+  void check_all(
+      std::size_t const num_threads = std::thread::hardware_concurrency()) {
+    parallel_for(table_.size(), num_threads,
+                 [&](std::size_t const i) { check_block(i); });
+  }
+
+  // Verifies all blocks in the background. *this has to outlive the future.
+  std::future<void> check_async(
+      std::size_t const num_threads = std::thread::hardware_concurrency()) {
+    return std::async(std::launch::async,
+                      [this, num_threads]() { check_all(num_threads); });
+  }
+
+  // Marks all blocks as verified if `hashes` (e.g. computed while loading
+  // the data) match the table.
+  void set_verified(std::vector<hash_t> const& hashes) {
+    verify(hashes == table_, "block integrity: invalid block checksum");
+    for (auto i = std::size_t{0U}; i != table_.size(); ++i) {
+      verified_[i].store(true, std::memory_order_release);
+    }
+  }
+
+  bool is_verified(std::size_t const i) const {
+    return verified_[i].load(std::memory_order_acquire);
+  }
+
+  std::size_t num_blocks() const noexcept { return table_.size(); }
+
+  std::size_t num_verified() const {
+    auto n = std::size_t{0U};
+    for (auto i = std::size_t{0U}; i != table_.size(); ++i) {
+      n += is_verified(i) ? 1U : 0U;
+    }
+    return n;
+  }
+
+  // End of the serialized data (= start of the block table).
+  std::uint8_t const* data_end() const noexcept { return data_ + size_; }
+
+  std::uint8_t const* data_;
+  std::size_t size_;
+  std::vector<hash_t> table_;
+  std::unique_ptr<std::atomic_bool[]> verified_;
+};
+
+// Reads the block table and verifies it against the header.
+// Blocks are not verified.
+template <mode const Mode>
+block_integrity make_block_integrity(std::uint8_t const* const from,
+                                     std::uint8_t const* const to) {
+  static_assert(is_mode_enabled(Mode, mode::WITH_BLOCK_INTEGRITY));
+  verify(to - from >= data_start(Mode) + static_cast<offset_t>(sizeof(hash_t)),
+         "block table missing");
+
+  auto const data = from + data_start(Mode);
+  auto n = std::uint64_t{0U};
+  std::memcpy(&n, to - sizeof(n), sizeof(n));
+  n = convert_endian<Mode>(n);
+  verify(n <= (static_cast<std::size_t>(to - data) - sizeof(n)) /
+                  sizeof(hash_t),
+         "block table truncated");
+
+  auto const table_start = to - sizeof(n) - n * sizeof(hash_t);
+  auto table = std::vector<hash_t>(n);
+  if (n != 0U) {
+    std::memcpy(table.data(), table_start, n * sizeof(hash_t));
+  }
+  for (auto& h : table) {
+    h = convert_endian<Mode>(h);
+  }
+
+  auto header = hash_t{};
+  std::memcpy(&header, from + integrity_start(Mode), sizeof(header));
+  verify(convert_endian<Mode>(header) == combine_segment_hashes(table),
+         "invalid block table checksum");
+
+  return block_integrity{data, table_start, std::move(table)};
+}
+
+// Verifies each block the deserialization walk checks a pointer into.
+template <mode Mode>
+struct block_check_context : public deserialization_context<Mode> {
+  using parent = deserialization_context<Mode>;
+
+  block_check_context(std::uint8_t const* from, std::uint8_t const* to,
+                      block_integrity& integrity)
+      : parent{from, to}, integrity_{integrity} {}
+
+  template <typename T>
+  void check_ptr(offset_ptr<T> const& el,
+                 std::size_t const size = parent::template type_size<T>())
+      const {
+    parent::check_ptr(el, size);
+    if (el != nullptr) {
+      integrity_.check(el.get(), size);
+    }
+  }
+
+  template <typename T>
+  void check_ptr(T* el,
+                 std::size_t const size = parent::template type_size<T>())
+      const {
+    parent::check_ptr(el, size);
+    if (el != nullptr) {
+      integrity_.check(el, size);
+    }
+  }
+
+  block_integrity& integrity_;
+};
+
 template <typename T, mode const Mode = mode::NONE>
 void check(std::uint8_t const* const from, std::uint8_t const* const to) {
   verify(to - from > data_start(Mode), "invalid range");
@@ -657,9 +1481,194 @@ void check(std::uint8_t const* const from, std::uint8_t const* const to) {
                    reinterpret_cast<char const*>(from + data_start(Mode)),
                    static_cast<std::size_t>(to - from - data_start(Mode))}),
            "invalid checksum");
+  } else if constexpr ((Mode & mode::WITH_SEGMENTED_INTEGRITY) ==
+                       mode::WITH_SEGMENTED_INTEGRITY) {
+    verify(convert_endian<Mode>(*reinterpret_cast<std::uint64_t const*>(
+               from + integrity_start(Mode))) ==
+               segmented_hash(std::string_view{
+                   reinterpret_cast<char const*>(from + data_start(Mode)),
+                   static_cast<std::size_t>(to - from - data_start(Mode))}),
+           "invalid segmented checksum");
+  } else if constexpr ((Mode & mode::WITH_BLOCK_INTEGRITY) ==
+                       mode::WITH_BLOCK_INTEGRITY) {
+    make_block_integrity<Mode>(from, to);
   }
 }
 
+// Type graph traits (see the SERIALIZE section for the general approach).
+// Types with a custom deserialize() overload are opaque.
+struct deserialize_probe {};
+
+template <typename T>
+int deserialize(deserialize_probe const&, T*);
+
+template <typename T, typename = void>
+struct has_custom_deserialize : std::true_type {};
+
+template <typename T>
+struct has_custom_deserialize<
+    T, std::enable_if_t<std::is_same_v<
+           int, decltype(deserialize(std::declval<deserialize_probe const&>(),
+                                     std::declval<T*>()))>>>
+    : std::false_type {};
+
+template <typename T>
+constexpr bool has_custom_deserialize_v = has_custom_deserialize<T>::value;
+
+template <typename T>
+constexpr bool is_plain_data(T const*, type_list<>) noexcept;
+
+template <typename T>
+constexpr bool visit_is_plain_data() noexcept {
+  return is_plain_data(null<decay_t<T>>(), type_list<>{});
+}
+
+template <typename Tuple, std::size_t... I>
+constexpr bool all_fields_plain_data(std::index_sequence<I...>) noexcept {
+  return (visit_is_plain_data<std::tuple_element_t<I, Tuple>>() && ...);
+}
+
+template <typename T>
+constexpr bool is_plain_data(T const*, type_list<>) noexcept {
+  using Type = decay_t<T>;
+  if constexpr (is_pointer_v<Type>) {
+    return false;
+  } else if constexpr (is_indexed_v<Type>) {
+    return visit_is_plain_data<typename Type::value_type>();
+  } else if constexpr (has_custom_deserialize_v<Type>) {
+    return false;  // opaque, also for unions
+  } else if constexpr (std::is_scalar_v<Type> || std::is_union_v<Type>) {
+    return true;
+  } else if constexpr (!to_tuple_works_v<Type>) {
+    return false;
+  } else {
+    using fields = fields_t<Type>;
+    return all_fields_plain_data<fields>(
+        std::make_index_sequence<std::tuple_size_v<fields>>());
+  }
+}
+
+template <typename T, template <typename> typename Ptr, bool Indexed,
+          typename TemplateSizeType>
+constexpr bool is_plain_data(
+    basic_vector<T, Ptr, Indexed, TemplateSizeType> const*,
+    type_list<>) noexcept {
+  return false;
+}
+
+template <typename Ptr>
+constexpr bool is_plain_data(generic_string<Ptr> const*,
+                             type_list<>) noexcept {
+  return false;
+}
+
+template <typename Ptr>
+constexpr bool is_plain_data(basic_string<Ptr> const*, type_list<>) noexcept {
+  return false;
+}
+
+template <typename Ptr>
+constexpr bool is_plain_data(basic_string_view<Ptr> const*,
+                             type_list<>) noexcept {
+  return false;
+}
+
+template <typename T, typename Ptr>
+constexpr bool is_plain_data(basic_unique_ptr<T, Ptr> const*,
+                             type_list<>) noexcept {
+  return false;
+}
+
+template <typename T, template <typename> typename Ptr, typename GetKey,
+          typename GetValue, typename Hash, typename Eq, std::size_t Width>
+constexpr bool is_plain_data(
+    hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq, Width> const*,
+    type_list<>) noexcept {
+  return false;
+}
+
+template <typename T, typename SizeType, template <typename> typename Vec,
+          std::size_t Log2MaxEntriesPerBucket>
+constexpr bool is_plain_data(
+    dynamic_fws_multimap_base<T, SizeType, Vec, Log2MaxEntriesPerBucket> const*,
+    type_list<>) noexcept {
+  return false;
+}
+
+template <typename... T>
+constexpr bool is_plain_data(variant<T...> const*, type_list<>) noexcept {
+  return false;
+}
+
+template <typename T>
+constexpr bool is_plain_data(optional<T> const*, type_list<>) noexcept {
+  return false;
+}
+
+template <typename T, std::size_t Size>
+constexpr bool is_plain_data(array<T, Size> const*, type_list<>) noexcept {
+  return visit_is_plain_data<T>();
+}
+
+template <std::size_t Size>
+constexpr bool is_plain_data(bitset<Size> const*, type_list<>) noexcept {
+  return true;
+}
+
+template <typename A, typename B>
+constexpr bool is_plain_data(pair<A, B> const*, type_list<>) noexcept {
+  return visit_is_plain_data<A>() && visit_is_plain_data<B>();
+}
+
+template <typename A, typename B>
+constexpr bool is_plain_data(std::pair<A, B> const*, type_list<>) noexcept {
+  return visit_is_plain_data<A>() && visit_is_plain_data<B>();
+}
+
+template <typename... T>
+constexpr bool is_plain_data(tuple<T...> const*, type_list<>) noexcept {
+  return (visit_is_plain_data<T>() && ...);
+}
+
+template <typename T, typename Tag>
+constexpr bool is_plain_data(strong<T, Tag> const*, type_list<>) noexcept {
+  return visit_is_plain_data<T>();
+}
+
+template <typename Rep, typename Period>
+constexpr bool is_plain_data(std::chrono::duration<Rep, Period> const*,
+                             type_list<>) noexcept {
+  return true;
+}
+
+template <typename Clock, typename Dur>
+constexpr bool is_plain_data(std::chrono::time_point<Clock, Dur> const*,
+                             type_list<>) noexcept {
+  return true;
+}
+
+// True if deserialize() for a T that is located in an already validated
+// memory range (e.g. the element block of a vector) has nothing left to do:
+// no pointers to convert or check, no invariants (bool flags, variant
+// indices, nested containers) and no endian conversion.
+template <typename T, mode Mode>
+constexpr bool is_trivially_deserializable_v =
+    !endian_conversion_necessary<Mode>() && visit_is_plain_data<T>();
+
+template <typename Fields, mode Mode, std::size_t... I>
+constexpr auto make_deserialize_plan(std::index_sequence<I...>) noexcept {
+  return make_field_plan(std::array<bool, sizeof...(I)>{
+      !is_trivially_deserializable_v<decay_t<std::tuple_element_t<I, Fields>>,
+                                     Mode>...});
+}
+
+template <typename T, mode Mode>
+struct deserialize_plan {
+  using fields = fields_t<T>;
+  static constexpr auto const value = make_deserialize_plan<fields, Mode>(
+      std::make_index_sequence<std::tuple_size_v<fields>>());
+};
+
 // --- GENERIC ---
 template <typename Ctx, typename T>
 void convert_endian_and_ptr(Ctx const& c, T* el) {
@@ -685,13 +1694,27 @@ void check_state(Ctx const& c, T* el) {
   }
 }
 
+template <typename T, typename Fn, std::size_t... I>
+void recurse_fields(T* el, Fn&& fn, std::index_sequence<I...>) {
+  auto const fields = to_ptr_tuple(*el);
+  CISTA_UNUSED_PARAM(fields)
+  CISTA_UNUSED_PARAM(fn)
+  (fn(std::get<I>(fields)), ...);
+}
+
 template <typename Ctx, typename T, typename Fn>
 void recurse(Ctx& c, T* el, Fn&& fn) {
   using Type = decay_t<T>;
   if constexpr (is_indexed_v<Type>) {
     fn(static_cast<typename T::value_type*>(el));
+  } else if constexpr (is_trivially_deserializable_v<Type, Ctx::MODE>) {
+    CISTA_UNUSED_PARAM(c)
+    CISTA_UNUSED_PARAM(el)
+    CISTA_UNUSED_PARAM(fn)
   } else if constexpr (to_tuple_works_v<Type>) {
-    for_each_ptr_field(*el, [&](auto& f) { fn(f); });
+    CISTA_UNUSED_PARAM(c)
+    recurse_fields(el, fn,
+                   plan_indices_t<deserialize_plan<Type, Ctx::MODE>>{});
   } else if constexpr (is_mode_enabled(Ctx::MODE, mode::_PHASE_II) &&
                        std::is_pointer_v<Type>) {
     if (*el != nullptr && c.add_checked(el)) {
@@ -707,7 +1730,10 @@ void recurse(Ctx& c, T* el, Fn&& fn) {
 template <typename Ctx, typename T>
 void deserialize(Ctx const& c, T* el) {
   c.check_ptr(el);
-  if constexpr (is_mode_disabled(Ctx::MODE, mode::_PHASE_II)) {
+  if constexpr (is_mode_disabled(Ctx::MODE, mode::_PHASE_II) &&
+                is_mode_disabled(Ctx::MODE, mode::WITH_RELOCATIONS)) {
+    // With relocations, the pointers were already patched by
+    // apply_relocations() (native byte order: nothing else to convert).
     convert_endian_and_ptr(c, el);
   }
   if constexpr (is_mode_disabled(Ctx::MODE, mode::UNCHECKED)) {
@@ -780,8 +1806,14 @@ template <typename Ctx, typename T, template <typename> typename Ptr,
           bool Indexed, typename TemplateSizeType, typename Fn>
 void recurse(Ctx&, basic_vector<T, Ptr, Indexed, TemplateSizeType>* el,
              Fn&& fn) {
-  for (auto& m : *el) {  // NOLINT(clang-analyzer-core.NullDereference)
-    fn(&m);
+  // The element block was validated as a whole by check_state().
+  if constexpr (is_trivially_deserializable_v<T, Ctx::MODE>) {
+    CISTA_UNUSED_PARAM(el)
+    CISTA_UNUSED_PARAM(fn)
+  } else {
+    for (auto& m : *el) {  // NOLINT(clang-analyzer-core.NullDereference)
+      fn(&m);
+    }
   }
 }
 
@@ -870,9 +1902,11 @@ void recurse(
 
 // --- HASH_STORAGE<T> ---
 template <typename Ctx, typename T, template <typename> typename Ptr,
-          typename GetKey, typename GetValue, typename Hash, typename Eq>
+          typename GetKey, typename GetValue, typename Hash, typename Eq,
+          std::size_t Width>
 void convert_endian_and_ptr(
-    Ctx const& c, hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq>* el) {
+    Ctx const& c,
+    hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq, Width>* el) {
   deserialize(c, &el->entries_);
   deserialize(c, &el->ctrl_);
   c.convert_endian(el->size_);
@@ -881,9 +1915,10 @@ void convert_endian_and_ptr(
 }
 
 template <typename Ctx, typename T, template <typename> typename Ptr,
-          typename GetKey, typename GetValue, typename Hash, typename Eq>
-void check_state(Ctx const& c,
-                 hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq>* el) {
+          typename GetKey, typename GetValue, typename Hash, typename Eq,
+          std::size_t Width>
+void check_state(
+    Ctx const& c, hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq, Width>* el) {
   using Type = decay_t<remove_pointer_t<decltype(el)>>;
   c.require(el->ctrl_ != nullptr, "hash storage: ctrl must be set");
   c.check_ptr(
@@ -947,11 +1982,18 @@ void check_state(Ctx const& c,
 
 template <typename Ctx, typename T, template <typename> typename Ptr,
           typename GetKey, typename GetValue, typename Hash, typename Eq,
-          typename Fn>
-void recurse(Ctx&, hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq>* el,
+          std::size_t Width, typename Fn>
+void recurse(Ctx&,
+             hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq, Width>* el,
              Fn&& fn) {
-  for (auto& m : *el) {
-    fn(&m);
+  // The entry block was validated as a whole by check_state().
+  if constexpr (is_trivially_deserializable_v<T, Ctx::MODE>) {
+    CISTA_UNUSED_PARAM(el)
+    CISTA_UNUSED_PARAM(fn)
+  } else {
+    for (auto& m : *el) {
+      fn(&m);
+    }
   }
 }
 
@@ -964,8 +2006,13 @@ void recurse(Ctx&, bitset<Size>* el, Fn&& fn) {
 // --- ARRAY<T> ---
 template <typename Ctx, typename T, std::size_t Size, typename Fn>
 void recurse(Ctx&, array<T, Size>* el, Fn&& fn) {
-  for (auto& m : *el) {
-    fn(&m);
+  if constexpr (is_trivially_deserializable_v<T, Ctx::MODE>) {
+    CISTA_UNUSED_PARAM(el)
+    CISTA_UNUSED_PARAM(fn)
+  } else {
+    for (auto& m : *el) {
+      fn(&m);
+    }
   }
 }
 
@@ -1018,17 +2065,154 @@ void convert_endian_and_ptr(Ctx const& c,
   c.convert_endian(*reinterpret_cast<Rep*>(el));
 }
 
+// Turns the offsets stored in raw pointers into absolute pointers by
+// applying the relocation table (mode::WITH_RELOCATIONS) in one linear pass.
+// Returns the end of the data (= start of the table).
+//
+// Every target is checked to lie inside the data (also with UNCHECKED).
+// The table is untrusted input: it only replaces the pointer patching of the
+// deserialization walk. Unless UNCHECKED, the walk still runs afterwards and
+// checks bounds, alignment and object states of the patched data (a table
+// entry that is not a pointer slot or a pointer slot without entry fails
+// there, or leaves a checked valid state).
+template <mode Mode>
+std::uint8_t* apply_relocations(std::uint8_t* from, std::uint8_t* to) {
+  static_assert(!endian_conversion_necessary<Mode>(),
+                "relocations require native byte order");
+  constexpr auto const WORD = sizeof(std::uint64_t);
+
+  auto const data = from + data_start(Mode);
+  auto table_size = std::uint64_t{0U};
+  verify(to - data >= static_cast<std::ptrdiff_t>(sizeof(table_size)),
+         "relocation table missing");
+  auto const table_end = to - sizeof(table_size);
+  std::memcpy(&table_size, table_end, sizeof(table_size));
+  verify(table_size >= WORD && table_size % WORD == 0U &&
+             table_size <= static_cast<std::uint64_t>(table_end - data),
+         "relocation table size");
+
+  auto const table_start = table_end - table_size;
+  auto const num_words = static_cast<std::size_t>(table_size / WORD - 1U);
+  auto distance = std::uint64_t{0U};
+  std::memcpy(&distance, table_end - WORD, sizeof(distance));
+  verify(distance <= static_cast<std::uint64_t>(table_start - data),
+         "relocation out of bounds");
+  if constexpr (is_mode_enabled(Mode, mode::_CONST)) {
+    verify(num_words == 0U, "raw pointer deserialize is not const");
+  }
+
+  auto const base = table_start - distance;
+  auto const data_size = static_cast<std::uint64_t>(table_start - data);
+  auto const word_span = 64U * RELOCATION_SLOT;
+  auto const num_full_words = static_cast<std::size_t>(distance / word_span);
+  for (auto w = std::size_t{0U}; w != num_words; ++w) {
+    auto bits = std::uint64_t{0U};
+    std::memcpy(&bits, table_start + w * WORD, sizeof(bits));
+    auto const word_base = base + w * word_span;
+
+    // Fetch the slots of the words ahead: one word spans 8 cache lines.
+    // Prefetching never faults, the address may point behind the data.
+    auto const ahead = reinterpret_cast<std::uintptr_t>(word_base) +
+                       RELOCATION_PREFETCH_WORDS * word_span;
+    for (auto l = std::size_t{0U}; l != word_span; l += 64U) {
+      prefetch_relocation_slots(reinterpret_cast<void const*>(ahead + l));
+    }
+
+    // Only words behind the full ones can mark slots outside of the data.
+    if (w >= num_full_words) {
+      auto const covered = static_cast<std::uint64_t>(w) * word_span;
+      auto const tail = covered < distance ? distance - covered : 0U;
+      verify((bits >> (tail / RELOCATION_SLOT)) == 0U,
+             "relocation out of bounds");
+    }
+
+    while (bits != 0U) {
+      auto const slot = word_base + trailing_zeros(bits) * RELOCATION_SLOT;
+      bits &= bits - 1U;
+
+      auto offset = offset_t{0};
+      std::memcpy(&offset, slot, sizeof(offset));
+      void* ptr = nullptr;
+      if (offset != NULLPTR_OFFSET) {
+        // slot + offset in [data, table_start) with one unsigned compare.
+        auto const rel = static_cast<std::uint64_t>(slot - data) +
+                         static_cast<std::uint64_t>(offset);
+        verify(rel < data_size, "relocation target out of bounds");
+        ptr = data + rel;
+      }
+      std::memcpy(slot, &ptr, sizeof(ptr));
+    }
+  }
+
+  return table_start;
+}
+
+// Deserializes data written with mode::WITH_BLOCK_INTEGRITY.
+// Only the blocks touched by the deserialization walk are verified (with
+// mode::UNCHECKED, only the objects the walk visits). The remaining blocks
+// can be verified with the given block_integrity on demand.
+template <typename T, mode const Mode>
+T* deserialize(std::uint8_t* from, std::uint8_t* to,
+               block_integrity& integrity) {
+  static_assert(is_mode_enabled(Mode, mode::WITH_BLOCK_INTEGRITY));
+  static_assert(is_mode_disabled(Mode, mode::CAST));
+
+  check<T, Mode>(from, to);
+  auto const el = reinterpret_cast<T*>(from + data_start(Mode));
+  auto data_end = from + (integrity.data_end() - from);
+
+  if constexpr (is_mode_enabled(Mode, mode::WITH_RELOCATIONS)) {
+    // Relocations patch pointers all over the data: verify everything first.
+    integrity.check_all();
+    data_end = apply_relocations<Mode>(from, data_end);
+    if constexpr (is_mode_disabled(Mode, mode::UNCHECKED)) {
+      deserialization_context<Mode> c{from, data_end};
+      deserialize(c, el);
+    }
+  } else {
+    block_check_context<Mode> c{from, data_end, integrity};
+    deserialize(c, el);
+  }
+
+  if constexpr ((Mode & mode::DEEP_CHECK) == mode::DEEP_CHECK) {
+    deep_check_context<Mode | mode::_PHASE_II> c1{from, data_end};
+    deserialize(c1, el);
+  }
+
+  return el;
+}
+
+template <typename T, mode const Mode>
+T const* deserialize(std::uint8_t const* from, std::uint8_t const* to,
+                     block_integrity& integrity) {
+  static_assert(!endian_conversion_necessary<Mode>(), "cannot be const");
+  return deserialize<T, Mode | mode::_CONST>(const_cast<std::uint8_t*>(from),
+                                             const_cast<std::uint8_t*>(to),
+                                             integrity);
+}
+
 template <typename T, mode const Mode = mode::NONE>
 T* deserialize(std::uint8_t* from, std::uint8_t* to = nullptr) {
   if constexpr (is_mode_enabled(Mode, mode::CAST)) {
     CISTA_UNUSED_PARAM(to)
     return reinterpret_cast<T*>(from);
+  } else if constexpr (is_mode_enabled(Mode, mode::WITH_BLOCK_INTEGRITY)) {
+    auto integrity = make_block_integrity<Mode>(from, to);
+    return deserialize<T, Mode>(from, to, integrity);
   } else {
     check<T, Mode>(from, to);
     auto const el = reinterpret_cast<T*>(from + data_start(Mode));
 
-    deserialization_context<Mode> c{from, to};
-    deserialize(c, el);
+    if constexpr (is_mode_enabled(Mode, mode::WITH_RELOCATIONS)) {
+      to = apply_relocations<Mode>(from, to);
+      if constexpr (is_mode_disabled(Mode, mode::UNCHECKED)) {
+        deserialization_context<Mode> c{from, to};
+        deserialize(c, el);
+      }
+    } else {
+      deserialization_context<Mode> c{from, to};
+      deserialize(c, el);
+    }
 
     if constexpr ((Mode & mode::DEEP_CHECK) == mode::DEEP_CHECK) {
       deep_check_context<Mode | mode::_PHASE_II> c1{from, to};
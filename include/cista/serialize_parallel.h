@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cista/parallel_for.h"
+#include "cista/serialization.h"
+#include "cista/targets/region.h"
+
+namespace cista {
+
+// Serialization of one field of the root object into its own region.
+template <typename Ctx>
+struct parallel_work_item {
+  using size_fn_t = std::size_t (*)(void const*, offset_t);
+  using write_fn_t = void (*)(Ctx&, void const*, offset_t);
+
+  void const* field_;
+  offset_t pos_;
+  size_fn_t size_fn_;
+  write_fn_t write_fn_;
+  std::size_t start_{0U}, size_{0U};
+};
+
+template <typename Field, mode Mode>
+std::size_t parallel_field_size(void const* field, offset_t const pos) {
+  auto c = sizing_context<Mode>{0U};
+  serialize(c, static_cast<Field const*>(field), pos);
+  return c.t_.size();
+}
+
+template <typename Field, typename Ctx>
+void parallel_field_write(Ctx& c, void const* field, offset_t const pos) {
+  serialize(c, static_cast<Field const*>(field), pos);
+}
+
+template <typename Ctx, typename T, std::size_t... I>
+std::vector<parallel_work_item<Ctx>> make_parallel_work_items(
+    T const& value, offset_t const root_pos, std::index_sequence<I...>) {
+  auto const fields = to_ptr_tuple(value);
+  CISTA_UNUSED_PARAM(fields)
+  CISTA_UNUSED_PARAM(root_pos)
+
+  using fields_t = decay_t<decltype(fields)>;
+  auto items = std::vector<parallel_work_item<Ctx>>{};
+  (items.emplace_back(parallel_work_item<Ctx>{
+       std::get<I>(fields),
+       root_pos + static_cast<offset_t>(
+                      reinterpret_cast<intptr_t>(std::get<I>(fields)) -
+                      reinterpret_cast<intptr_t>(&value)),
+       &parallel_field_size<
+           decay_t<remove_pointer_t<std::tuple_element_t<I, fields_t>>>,
+           Ctx::MODE>,
+       &parallel_field_write<
+           decay_t<remove_pointer_t<std::tuple_element_t<I, fields_t>>>,
+           Ctx>}),
+   ...);
+  return items;
+}
+
+// Serializes the fields of the root object concurrently.
+//
+// 1. The root object is written as usual.
+// 2. The out-of-line data of each field that needs serialization (see
+//    serialize_plan) is sized with a dry run. Each field gets its own
+//    region behind the root object. Regions are aligned to REGION_ALIGNMENT
+//    (this is the only difference to the output of serialize()).
+// 3. The regions are filled concurrently. Each thread keeps its own pointer
+//    bookkeeping. Pointers between regions are resolved in the end.
+//    With WITH_SEGMENTED_INTEGRITY / WITH_BLOCK_INTEGRITY, each thread also
+//    hashes the segments within its region.
+//
+// The output only depends on the value, not on the number of threads.
+// Roots that are not reflected aggregates are serialized sequentially.
+template <mode const Mode = mode::NONE, typename Target, typename T>
+void serialize_parallel(
+    Target& t, T& value,
+    std::size_t const num_threads = std::thread::hardware_concurrency()) {
+  using Type = decay_t<T>;
+  constexpr auto const REGION_ALIGNMENT = std::size_t{64U};
+  constexpr auto const TRACK = has_non_owning_ptr_v<Type>;
+  constexpr auto const HASH_SEGMENTS =
+      (is_mode_enabled(Mode, mode::WITH_SEGMENTED_INTEGRITY) ||
+       is_mode_enabled(Mode, mode::WITH_BLOCK_INTEGRITY)) &&
+      has_track_segments_v<Target>;
+
+  if constexpr (is_pointer_v<Type> || is_indexed_v<Type> ||
+                has_custom_serialize_v<Type> || !to_tuple_works_v<Type>) {
+    CISTA_UNUSED_PARAM(num_threads)
+    serialize<Mode>(t, value);
+  } else {
+    using region_ctx_t = serialization_context<region, Mode, TRACK>;
+
+    serialization_context<Target, Mode, TRACK> c{t};
+    auto const integrity_offset = write_header<T>(c);
+    auto const root_pos =
+        c.write(&value, serialized_size<T>(), std::alignment_of_v<Type>);
+
+    // Layout: size all regions, then place them behind the root object.
+    auto items = make_parallel_work_items<region_ctx_t>(
+        value, root_pos, plan_indices_t<serialize_plan<Type, Mode>>{});
+    parallel_for(items.size(), num_threads, [&](std::size_t const i) {
+      items[i].size_ = items[i].size_fn_(items[i].field_, items[i].pos_);
+    });
+    auto total = t.size();
+    for (auto& item : items) {
+      item.start_ =
+          (total + REGION_ALIGNMENT - 1U) & ~(REGION_ALIGNMENT - 1U);
+      total = item.start_ + item.size_;
+    }
+    t.resize(total);
+
+    // Write: largest regions first for a better load balance.
+    auto order = std::vector<std::size_t>(items.size());
+    std::iota(begin(order), end(order), std::size_t{0U});
+    std::stable_sort(begin(order), end(order),
+                     [&](std::size_t const a, std::size_t const b) {
+                       return items[a].size_ > items[b].size_;
+                     });
+    auto regions = std::vector<region>{};
+    regions.reserve(items.size());
+    for (auto const& item : items) {
+      regions.emplace_back(t.base(), total, item.start_,
+                           item.start_ + item.size_);
+    }
+    auto contexts = std::vector<std::optional<region_ctx_t>>(items.size());
+    auto segments =
+        std::vector<std::pair<std::size_t, std::vector<hash_t>>>(items.size());
+    parallel_for(items.size(), num_threads, [&](std::size_t const i) {
+      auto const idx = order[i];
+      auto& item = items[idx];
+      auto& ctx = contexts[idx].emplace(regions[idx]);
+      item.write_fn_(ctx, item.field_, item.pos_);
+      verify(regions[idx].pos_ == item.start_ + item.size_,
+             "parallel serialize: region size mismatch");
+      if constexpr (HASH_SEGMENTS) {
+        segments[idx] =
+            t.hash_segments_within(item.start_, item.start_ + item.size_);
+      }
+    });
+
+    // Merge the bookkeeping of all regions and resolve all pointers.
+    // Pointer fix-ups mark the segments they touch dirty (rehashed in the
+    // end), as do the segments that span region boundaries.
+    if constexpr (HASH_SEGMENTS) {
+      for (auto const& [first, hashes] : segments) {
+        t.segments_hashed(first, hashes);
+      }
+    }
+    for (auto& ctx : contexts) {
+      c.merge(*ctx);
+    }
+    finish_serialization(c, integrity_offset);
+  }
+}
+
+}  // namespace cista
@@ -0,0 +1,262 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cinttypes>
+#include <string>
+#include <string_view>
+
+#include "cista/mmap.h"
+#include "cista/next_power_of_2.h"
+#include "cista/verify.h"
+
+namespace cista {
+
+// Anonymous shared memory (memfd) to hand serialized data to other processes
+// on the same host without a file on disk:
+//
+//   auto out = cista::buf<cista::memfd>{cista::memfd{"dataset"}};
+//   cista::serialize(out, data);
+//   out.buf_.seal();
+//   // pass out.buf_.fd() (SCM_RIGHTS, fork) or out.buf_.path() to readers
+//
+// seal() makes the content immutable (F_SEAL_WRITE, F_SEAL_SHRINK, ...): a
+// reader that sees a sealed memfd of a trusted writer can use mode::CAST
+// instead of validating the data again (see memfd_view::is_sealed()).
+struct memfd {
+  static constexpr auto const SEALS =
+      F_SEAL_SEAL | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE;
+
+  memfd() = default;
+
+  explicit memfd(char const* name)
+      : fd_{::memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING)} {
+    verify(fd_ != -1, "memfd_create error");
+  }
+
+  ~memfd() {
+    unmap();
+    if (fd_ != -1) {
+      ::close(fd_);
+    }
+  }
+
+  memfd(memfd const&) = delete;
+  memfd& operator=(memfd const&) = delete;
+
+  memfd(memfd&& o) noexcept
+      : fd_{o.fd_},
+        addr_{o.addr_},
+        capacity_{o.capacity_},
+        used_size_{o.used_size_},
+        sealed_{o.sealed_} {
+    o.fd_ = -1;
+    o.addr_ = nullptr;
+  }
+
+  memfd& operator=(memfd&& o) noexcept {
+    unmap();
+    if (fd_ != -1) {
+      ::close(fd_);
+    }
+    fd_ = o.fd_;
+    addr_ = o.addr_;
+    capacity_ = o.capacity_;
+    used_size_ = o.used_size_;
+    sealed_ = o.sealed_;
+    o.fd_ = -1;
+    o.addr_ = nullptr;
+    return *this;
+  }
+
+  void resize(std::size_t const new_size) {
+    reserve(new_size);
+    used_size_ = new_size;
+  }
+
+  void reserve(std::size_t const new_size) {
+    verify(!sealed_, "memfd sealed");
+    if (capacity_ < new_size) {
+      grow(next_power_of_two(new_size));
+    }
+  }
+
+  // Truncates the memfd to size() and seals it. The data stays accessible
+  // (read-only) through this object.
+  void seal() {
+    verify(!sealed_, "memfd already sealed");
+    unmap();  // F_SEAL_WRITE fails while writable shared mappings exist
+    verify(::ftruncate(fd_, static_cast<off_t>(used_size_)) == 0,
+           "memfd truncate error");
+    verify(::fcntl(fd_, F_ADD_SEALS, SEALS) == 0, "memfd seal error");
+    sealed_ = true;
+    capacity_ = used_size_;
+    if (used_size_ != 0U) {
+      addr_ = ::mmap(nullptr, used_size_, PROT_READ, MAP_SHARED, fd_, 0);
+      verify(addr_ != MAP_FAILED, "map error");
+    }
+  }
+
+  bool is_sealed() const noexcept { return sealed_; }
+
+  int fd() const noexcept { return fd_; }
+
+  // Path other processes of the same user can open (see memfd_view).
+  std::string path() const {
+    return "/proc/" + std::to_string(::getpid()) + "/fd/" +
+           std::to_string(fd_);
+  }
+
+  std::size_t size() const noexcept { return used_size_; }
+
+  std::string_view view() const noexcept {
+    return {static_cast<char const*>(addr_), size()};
+  }
+  std::uint8_t* data() noexcept { return static_cast<std::uint8_t*>(addr_); }
+  std::uint8_t const* data() const noexcept {
+    return static_cast<std::uint8_t const*>(addr_);
+  }
+
+  std::uint8_t* begin() noexcept { return data(); }
+  std::uint8_t* end() noexcept { return data() + used_size_; }
+  std::uint8_t const* begin() const noexcept { return data(); }
+  std::uint8_t const* end() const noexcept { return data() + used_size_; }
+
+  std::uint8_t& operator[](std::size_t const i) noexcept { return data()[i]; }
+  std::uint8_t const& operator[](std::size_t const i) const noexcept {
+    return data()[i];
+  }
+
+private:
+  void grow(std::size_t const new_capacity) {
+    verify(::ftruncate(fd_, static_cast<off_t>(new_capacity)) == 0,
+           "memfd resize error");
+    auto const addr =
+        addr_ == nullptr
+            ? ::mmap(nullptr, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd_, 0)
+            : ::mremap(addr_, capacity_, new_capacity, MREMAP_MAYMOVE);
+    verify(addr != MAP_FAILED, "map error");
+    addr_ = addr;
+    capacity_ = new_capacity;
+  }
+
+  void unmap() {
+    if (addr_ != nullptr) {
+      ::munmap(addr_, capacity_);
+      addr_ = nullptr;
+    }
+  }
+
+  int fd_{-1};
+  void* addr_{nullptr};
+  std::size_t capacity_{0U};
+  std::size_t used_size_{0U};
+  bool sealed_{false};
+};
+
+// Reader side of memfd: maps a descriptor received from the writer (or a
+// /proc/<pid>/fd/<fd> path). The descriptor is not needed after mapping.
+//
+// protection::READ maps read-only (offset data structures, mode::CAST).
+// protection::PRIVATE maps copy-on-write for deserialization that has to
+// write (raw pointers, endian conversion) - see cista::mmap.
+struct memfd_view {
+  explicit memfd_view(int const fd,
+                      mmap::protection const prot = mmap::protection::READ) {
+    map(fd, prot);
+  }
+
+  explicit memfd_view(char const* path,
+                      mmap::protection const prot = mmap::protection::READ) {
+    struct closer {
+      ~closer() { ::close(fd_); }
+      int fd_;
+    } c{::open(path, O_RDONLY | O_CLOEXEC)};
+    verify(c.fd_ != -1, "unable to open memfd");
+    map(c.fd_, prot);
+  }
+
+  ~memfd_view() { unmap(); }
+
+  memfd_view(memfd_view const&) = delete;
+  memfd_view& operator=(memfd_view const&) = delete;
+
+  memfd_view(memfd_view&& o) noexcept
+      : addr_{o.addr_}, size_{o.size_}, sealed_{o.sealed_} {
+    o.addr_ = nullptr;
+  }
+
+  memfd_view& operator=(memfd_view&& o) noexcept {
+    unmap();
+    addr_ = o.addr_;
+    size_ = o.size_;
+    sealed_ = o.sealed_;
+    o.addr_ = nullptr;
+    return *this;
+  }
+
+  // True if the content can not change anymore (sealed by memfd::seal()).
+  bool is_sealed() const noexcept { return sealed_; }
+
+  std::size_t size() const noexcept { return size_; }
+
+  std::string_view view() const noexcept {
+    return {static_cast<char const*>(addr_), size()};
+  }
+  std::uint8_t* data() noexcept { return static_cast<std::uint8_t*>(addr_); }
+  std::uint8_t const* data() const noexcept {
+    return static_cast<std::uint8_t const*>(addr_);
+  }
+
+  std::uint8_t* begin() noexcept { return data(); }
+  std::uint8_t* end() noexcept { return data() + size_; }
+  std::uint8_t const* begin() const noexcept { return data(); }
+  std::uint8_t const* end() const noexcept { return data() + size_; }
+
+  std::uint8_t& operator[](std::size_t const i) noexcept { return data()[i]; }
+  std::uint8_t const& operator[](std::size_t const i) const noexcept {
+    return data()[i];
+  }
+
+private:
+  void map(int const fd, mmap::protection const prot) {
+    verify(prot == mmap::protection::READ ||
+               prot == mmap::protection::PRIVATE,
+           "memfd_view: protection not supported");
+
+    auto const seals = ::fcntl(fd, F_GET_SEALS);
+    sealed_ = seals != -1 && (seals & memfd::SEALS) == memfd::SEALS;
+
+    struct stat s;
+    verify(::fstat(fd, &s) != -1, "fstat error");
+    size_ = static_cast<std::size_t>(s.st_size);
+    if (size_ != 0U) {
+      addr_ = prot == mmap::protection::READ
+                  ? ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0)
+                  : ::mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE, fd, 0);
+      verify(addr_ != MAP_FAILED, "map error");
+    }
+  }
+
+  void unmap() {
+    if (addr_ != nullptr) {
+      ::munmap(addr_, size_);
+      addr_ = nullptr;
+    }
+  }
+
+  void* addr_{nullptr};
+  std::size_t size_{0U};
+  bool sealed_{false};
+};
+
+}  // namespace cista
+
+#endif
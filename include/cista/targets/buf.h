@@ -1,12 +1,17 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <memory>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "cista/hash.h"
 #include "cista/offset_t.h"
+#include "cista/segmented_hash.h"
 #include "cista/serialized_size.h"
 #include "cista/verify.h"
 
@@ -30,24 +35,56 @@ struct buf {
         buf_.size() - static_cast<std::size_t>(start)});
   }
 
+  std::vector<hash_t> segment_hashes(offset_t const start = 0U) {
+    if (segments_.is_tracking(static_cast<std::size_t>(start))) {
+      return segments_.finish(
+          size(), [&](std::size_t const i) { return segment(start, i); },
+          std::thread::hardware_concurrency());
+    }
+    return ::cista::segment_hashes(std::string_view{
+        reinterpret_cast<char const*>(&buf_[static_cast<std::size_t>(start)]),
+        buf_.size() - static_cast<std::size_t>(start)});
+  }
+
+  // Hash segments starting at `start` while writing (see segment_tracker).
+  void track_segments(offset_t const start) {
+    segments_.begin(static_cast<std::size_t>(start));
+  }
+
+  // Hashes the tracked segments that lie completely within [from, to).
+  // For data written in place after resize() (e.g. by the workers of
+  // serialize_parallel): disjoint ranges can be hashed concurrently.
+  // Returns the first segment index and the hashes for segments_hashed().
+  std::pair<std::size_t, std::vector<hash_t>> hash_segments_within(
+      std::size_t const from, std::size_t const to) const {
+    auto const [first, last] = segments_.segments_within(from, to);
+    auto hashes = std::vector<hash_t>{};
+    hashes.reserve(last - first);
+    for (auto i = first; i != last; ++i) {
+      hashes.emplace_back(
+          hash(segment(static_cast<offset_t>(segments_.start_), i)));
+    }
+    return {first, std::move(hashes)};
+  }
+
+  void segments_hashed(std::size_t const first,
+                       std::vector<hash_t> const& hashes) {
+    segments_.hashed(first, hashes);
+  }
+
   template <typename T>
   void write(std::size_t const pos, T const& val) {
     verify(buf_.size() >= pos + serialized_size<T>(), "out of bounds write");
     std::memcpy(&buf_[pos], &val, serialized_size<T>());
+    segments_.patched(pos, serialized_size<T>());
   }
 
   offset_t write(void const* ptr, std::size_t const num_bytes,
                  std::size_t alignment = 0U) {
     auto start = static_cast<offset_t>(size());
-    if (alignment > 1U && buf_.size() != 0U) {
-      auto unaligned_ptr = static_cast<void*>(addr(start));
-      auto space = std::numeric_limits<std::size_t>::max();
-      auto const aligned_ptr =
-          std::align(alignment, num_bytes, unaligned_ptr, space);
-      auto const new_offset = static_cast<offset_t>(
-          aligned_ptr ? static_cast<std::uint8_t*>(aligned_ptr) - base() : 0U);
-      auto const adjustment = static_cast<offset_t>(new_offset - start);
-      start += adjustment;
+    if (alignment > 1U) {
+      auto const mask = static_cast<offset_t>(alignment - 1U);
+      start = (start + mask) & ~mask;
     }
 
     auto const space_left =
@@ -58,6 +95,9 @@ struct buf {
       buf_.resize(buf_.size() + missing);
     }
     std::memcpy(addr(start), ptr, num_bytes);
+    segments_.appended(size(), [&](std::size_t const i) {
+      return segment(static_cast<offset_t>(segments_.start_), i);
+    });
 
     return start;
   }
@@ -67,9 +107,29 @@ struct buf {
     return buf_[i];
   }
   std::size_t size() const noexcept { return buf_.size(); }
-  void reset() { buf_.resize(0U); }
+  void reserve(std::size_t const size) { buf_.reserve(size); }
+  // Growing keeps the segment tracking: the new segments are hashed with
+  // hash_segments_within() or in the end (see segment_tracker::grown()).
+  void resize(std::size_t const size) {
+    if (size < buf_.size()) {
+      segments_.cancel();
+    }
+    buf_.resize(size);
+    segments_.grown(size);
+  }
+  void reset() {
+    segments_.cancel();
+    buf_.resize(0U);
+  }
+
+  std::string_view segment(offset_t const start, std::size_t const i) const {
+    auto const from = static_cast<std::size_t>(start) + i * SEGMENT_SIZE;
+    return std::string_view{reinterpret_cast<char const*>(&buf_[from]),
+                            std::min(SEGMENT_SIZE, buf_.size() - from)};
+  }
 
   Buf buf_;
+  segment_tracker segments_;
 };
 
 template <typename Buf>
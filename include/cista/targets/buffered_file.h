@@ -0,0 +1,298 @@
+#pragma once
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+#include "cista/hash.h"
+#include "cista/offset_t.h"
+#include "cista/posix_io.h"
+#include "cista/radix_sort.h"
+#include "cista/segmented_hash.h"
+#include "cista/serialized_size.h"
+#include "cista/verify.h"
+
+namespace cista {
+
+// Writer of basic_buffered_file: writes each full buffer synchronously.
+struct pwrite_writer {
+  struct options {};
+
+  pwrite_writer(char const*, int const fd, std::size_t const capacity,
+                options const&)
+      : fd_{fd}, buf_(capacity) {}
+
+  // First buffer to fill.
+  std::uint8_t* buffer() noexcept { return buf_.data(); }
+
+  // Writes `size` bytes of `buf` to `pos`. Returns the next buffer to fill.
+  std::uint8_t* write(std::uint8_t* buf, std::size_t const size,
+                      std::size_t const pos) {
+    pwrite_all(fd_, buf, size, pos);
+    return buf;
+  }
+
+  // Waits until all writes are completed.
+  void wait() {}
+
+  int fd_;
+  std::vector<std::uint8_t> buf_;
+};
+
+// File target that appends through user-space buffers. Full buffers are
+// handed to the Writer (see pwrite_writer), so the target never seeks.
+//
+// Positional writes (pointer fix-ups, header fields) into the buffer that
+// is currently filled are applied in memory. All others are queued and
+// applied sorted by position by flush() - once at the end for serialize().
+// The file is complete after close(). Destruction closes the file as well,
+// but ignores errors.
+template <typename Writer>
+struct basic_buffered_file {
+  static constexpr auto const DEFAULT_BUFFER_SIZE =
+      std::size_t{8U * 1024U * 1024U};  // 8MB
+
+  enum class durability { NONE, SYNC_ON_CLOSE };
+
+  explicit basic_buffered_file(
+      char const* path, std::size_t const buffer_size = DEFAULT_BUFFER_SIZE,
+      durability const d = durability::NONE,
+      typename Writer::options const& writer_options = {})
+      : fd_{open_for_writing(path)},
+        capacity_{buffer_size},
+        durability_{d},
+        writer_{path, fd_, capacity_, writer_options},
+        buf_{writer_.buffer()} {
+    verify(capacity_ != 0U, "buffered file: empty buffer");
+  }
+
+  // Errors can not be reported here: call close() to see them (a failed
+  // write or sync means the file is incomplete).
+  ~basic_buffered_file() {
+    if (fd_ != -1) {
+      try {
+        close();
+      } catch (...) {
+      }
+    }
+  }
+
+  basic_buffered_file(basic_buffered_file const&) = delete;
+  basic_buffered_file& operator=(basic_buffered_file const&) = delete;
+  basic_buffered_file(basic_buffered_file&&) = delete;
+  basic_buffered_file& operator=(basic_buffered_file&&) = delete;
+
+  std::size_t size() const noexcept { return size_; }
+
+  template <typename T>
+  void write(std::size_t const pos, T const& val) {
+    patch(pos, &val, serialized_size<T>());
+  }
+
+  offset_t write(void const* ptr, std::size_t const size,
+                 std::size_t const alignment = 0U) {
+    auto start = size_;
+    if (alignment > 1U) {
+      start = (start + alignment - 1U) & ~(alignment - 1U);
+    }
+    append(nullptr, start - size_);
+    append(ptr, size);
+    return static_cast<offset_t>(start);
+  }
+
+  // Writes all buffers and all queued positional writes to the file.
+  void flush() {
+    if (used_ != 0U) {
+      buf_ = writer_.write(buf_, used_, size_ - used_);
+      used_ = 0U;
+    }
+    writer_.wait();
+    apply_patches();
+  }
+
+  // Flushes, syncs (depending on the durability setting) and closes.
+  // Throws if any of these fail. The file is closed in any case.
+  void close() {
+    struct closer {
+      ~closer() {
+        if (f_.fd_ != -1) {
+          ::close(f_.fd_);
+          f_.fd_ = -1;
+        }
+      }
+      basic_buffered_file& f_;
+    } c{*this};
+    flush();
+    if (durability_ == durability::SYNC_ON_CLOSE) {
+#ifdef __linux__
+      verify(::fdatasync(fd_) == 0, "fdatasync error");
+#else
+      verify(::fsync(fd_) == 0, "fsync error");
+#endif
+    }
+    auto const fd = fd_;
+    fd_ = -1;
+    verify(::close(fd) == 0, "close error");
+  }
+
+  std::uint64_t checksum(offset_t const start = 0) {
+    constexpr auto const block_size =
+        static_cast<std::size_t>(512U * 1024U);  // 512kB
+    verify(size_ >= static_cast<std::size_t>(start), "invalid checksum offset");
+    flush();
+    auto c = BASE_HASH;
+    auto buf = std::vector<char>(block_size);
+    for (auto pos = static_cast<std::size_t>(start); pos < size_;
+         pos += block_size) {
+      auto const n = std::min(block_size, size_ - pos);
+      pread_all(fd_, buf.data(), n, pos);
+      c = hash(std::string_view{buf.data(), n}, c);
+    }
+    return c;
+  }
+
+  std::vector<hash_t> segment_hashes(offset_t const start = 0) {
+    verify(size_ >= static_cast<std::size_t>(start), "invalid checksum offset");
+    flush();
+    auto const reader = [&](std::size_t const from, std::size_t const size,
+                            char* out) { pread_all(fd_, out, size, from); };
+    if (segments_.is_tracking(static_cast<std::size_t>(start))) {
+      return segments_.finish(size_, reader);
+    }
+    auto hashes = std::vector<hash_t>{};
+    auto buf = std::vector<char>(SEGMENT_SIZE);
+    for (auto pos = static_cast<std::size_t>(start); pos < size_;
+         pos += SEGMENT_SIZE) {
+      auto const n = std::min(SEGMENT_SIZE, size_ - pos);
+      reader(pos, n, buf.data());
+      hashes.emplace_back(hash(std::string_view{buf.data(), n}));
+    }
+    return hashes;
+  }
+
+  // Hash segments starting at `start` while writing (see segment_tracker).
+  void track_segments(offset_t const start) {
+    verify(static_cast<std::size_t>(start) == size_,
+           "track segments: not at end");
+    segments_.begin(size_);
+  }
+
+  struct queued_patch {
+    std::size_t pos_;
+    std::size_t data_;  // index into patch_bytes_, grows with every patch
+    std::size_t size_;
+  };
+
+  // Appends `size` bytes (nullptr: zero padding).
+  void append(void const* ptr, std::size_t size) {
+    segments_.appended(ptr, size);
+    auto data = static_cast<std::uint8_t const*>(ptr);
+    while (size != 0U) {
+      auto const n = std::min(size, capacity_ - used_);
+      if (data == nullptr) {
+        std::memset(buf_ + used_, 0, n);
+      } else {
+        std::memcpy(buf_ + used_, data, n);
+        data += n;
+      }
+      used_ += n;
+      size_ += n;
+      size -= n;
+      if (used_ == capacity_) {
+        buf_ = writer_.write(buf_, used_, size_ - used_);
+        used_ = 0U;
+      }
+    }
+  }
+
+  void patch(std::size_t const pos, void const* ptr, std::size_t size) {
+    verify(pos + size <= size_, "out of bounds write");
+    segments_.patched(pos, ptr, size);
+
+    auto const buffered = size_ - used_;
+    auto const data = static_cast<std::uint8_t const*>(ptr);
+    if (pos + size > buffered) {
+      auto const skip = pos < buffered ? buffered - pos : 0U;
+      std::memcpy(buf_ + (pos + skip - buffered), data + skip, size - skip);
+      size = skip;
+    }
+    if (size != 0U) {
+      patches_.emplace_back(queued_patch{pos, patch_bytes_.size(), size});
+      patch_bytes_.insert(end(patch_bytes_), data, data + size);
+    }
+  }
+
+  // Writes queued patches in ascending file order. Patches closer than
+  // MAX_PATCH_GAP are merged into one window that is read, patched and
+  // written back with one pread and one pwrite (later patches win).
+  void apply_patches() {
+    constexpr auto const MAX_PATCH_GAP = std::size_t{4096U};
+
+    if (patches_.empty()) {
+      return;
+    }
+
+    radix_sort(patches_, [](queued_patch const& p) {
+      return static_cast<std::uint64_t>(p.pos_);
+    });
+
+    auto window = std::vector<std::uint8_t>{};
+    for (auto it = begin(patches_); it != end(patches_);) {
+      auto const window_start = it->pos_;
+      auto window_end = it->pos_ + it->size_;
+      auto gaps = false;
+      auto overlap = false;
+      auto last = std::next(it);
+      for (; last != end(patches_) &&
+             last->pos_ <= window_end + MAX_PATCH_GAP &&
+             last->pos_ + last->size_ - window_start <= capacity_;
+           ++last) {
+        gaps = gaps || last->pos_ > window_end;
+        overlap = overlap || last->pos_ < window_end;
+        window_end = std::max(window_end,
+                              static_cast<std::size_t>(last->pos_ +
+                                                       last->size_));
+      }
+
+      window.resize(window_end - window_start);
+      if (gaps) {
+        pread_all(fd_, window.data(), window.size(), window_start);
+      }
+      if (overlap) {
+        // Insertion order: data_ is unique and never wraps.
+        std::sort(it, last, [](queued_patch const& a, queued_patch const& b) {
+          return a.data_ < b.data_;
+        });
+      }
+      for (; it != last; ++it) {
+        std::memcpy(&window[it->pos_ - window_start], &patch_bytes_[it->data_],
+                    it->size_);
+      }
+      pwrite_all(fd_, window.data(), window.size(), window_start);
+    }
+
+    patches_.clear();
+    patch_bytes_.clear();
+  }
+
+  int fd_{-1};
+  std::size_t size_{0U};
+  std::size_t capacity_;
+  durability durability_;
+  Writer writer_;
+  std::uint8_t* buf_;
+  std::size_t used_{0U};
+  std::vector<queued_patch> patches_;
+  std::vector<std::uint8_t> patch_bytes_;
+  streamed_segments segments_;
+};
+
+using buffered_file = basic_buffered_file<pwrite_writer>;
+
+}  // namespace cista
+
+#endif
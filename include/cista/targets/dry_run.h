@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+#include "cista/hash.h"
+#include "cista/offset_t.h"
+
+namespace cista {
+
+// Target that only keeps track of the output size.
+// Used to compute the exact serialized size before writing anything.
+struct dry_run {
+  dry_run() = default;
+  explicit dry_run(std::size_t const size) : size_{size} {}
+
+  template <typename T>
+  void write(std::size_t const, T const&) noexcept {}
+
+  offset_t write(void const*, std::size_t const num_bytes,
+                 std::size_t const alignment = 0U) noexcept {
+    auto start = size_;
+    if (alignment > 1U) {
+      start = (start + alignment - 1U) & ~(alignment - 1U);
+    }
+    size_ = start + num_bytes;
+    return static_cast<offset_t>(start);
+  }
+
+  std::uint64_t checksum(offset_t const = 0) const noexcept { return 0U; }
+  std::vector<hash_t> segment_hashes(offset_t const = 0) const { return {}; }
+
+  std::size_t size() const noexcept { return size_; }
+
+  std::size_t size_{0U};
+};
+
+}  // namespace cista
@@ -14,11 +14,13 @@
 
 #include <cinttypes>
 #include <memory>
+#include <vector>
 
 #include "cista/buffer.h"
 #include "cista/chunk.h"
 #include "cista/hash.h"
 #include "cista/offset_t.h"
+#include "cista/segmented_hash.h"
 #include "cista/serialized_size.h"
 #include "cista/targets/file.h"
 #include "cista/verify.h"
@@ -147,6 +149,42 @@ struct file {
     return c;
   }
 
+  void read(std::size_t const from, std::size_t const size, char* out) const {
+    OVERLAPPED overlapped = {0};
+    overlapped.Offset = static_cast<DWORD>(from);
+#ifdef _WIN64
+    overlapped.OffsetHigh = static_cast<DWORD>(from >> 32U);
+#endif
+    DWORD bytes_read = {0};
+    verify(ReadFile(f_, out, static_cast<DWORD>(size), &bytes_read,
+                    &overlapped),
+           "checksum read error");
+    verify(bytes_read == size, "checksum read error bytes read");
+  }
+
+  std::vector<hash_t> segment_hashes(offset_t const start = 0) {
+    if (segments_.is_tracking(static_cast<std::size_t>(start))) {
+      return segments_.finish(size_, [&](auto const from, auto const size,
+                                         char* out) { read(from, size, out); });
+    }
+    auto hashes = std::vector<hash_t>{};
+    auto buf = std::vector<char>(SEGMENT_SIZE);
+    chunk(static_cast<unsigned>(SEGMENT_SIZE),
+          size_ - static_cast<std::size_t>(start),
+          [&](auto const from, auto const size) {
+            read(static_cast<std::size_t>(start) + from, size, buf.data());
+            hashes.emplace_back(hash(std::string_view{buf.data(), size}));
+          });
+    return hashes;
+  }
+
+  // Hash segments starting at `start` while writing (see segment_tracker).
+  void track_segments(offset_t const start) {
+    verify(static_cast<std::size_t>(start) == size_,
+           "track segments: not at end");
+    segments_.begin(size_);
+  }
+
   template <typename T>
   void write(std::size_t const pos, T const& val) {
     OVERLAPPED overlapped = {0};
@@ -159,6 +197,7 @@ struct file {
            "write(pos, val) write error");
     verify(bytes_written == sizeof(T),
            "write(pos, val) write error bytes written");
+    segments_.patched(pos, &val, sizeof(T));
   }
 
   offset_t write(void const* ptr, std::size_t const size,
@@ -187,6 +226,7 @@ struct file {
              "write padding error");
       verify(bytes_written == num_padding_bytes,
              "write padding error bytes written");
+      segments_.appended(nullptr, num_padding_bytes);
       size_ = curr_offset;
     }
 
@@ -202,6 +242,8 @@ struct file {
       verify(bytes_written == block_size, "write error bytes written");
     });
 
+    segments_.appended(ptr, size);
+
     auto const offset = size_;
     size_ += size;
 
@@ -210,6 +252,7 @@ struct file {
 
   HANDLE f_{nullptr};
   std::size_t size_{0U};
+  streamed_segments segments_;
 };
 }  // namespace cista
 #else
@@ -287,12 +330,43 @@ struct file {
     return c;
   }
 
+  std::vector<hash_t> segment_hashes(offset_t const start = 0) {
+    if (segments_.is_tracking(static_cast<std::size_t>(start))) {
+      return segments_.finish(
+          size_, [&](auto const from, auto const size, char* out) {
+            verify(!std::fseek(f_, static_cast<long>(from), SEEK_SET),
+                   "fseek error");
+            verify(std::fread(out, 1U, size, f_) == size, "invalid read");
+          });
+    }
+
+    verify(size_ >= static_cast<std::size_t>(start), "invalid checksum offset");
+    verify(!std::fseek(f_, static_cast<long>(start), SEEK_SET), "fseek error");
+    auto hashes = std::vector<hash_t>{};
+    auto buf = std::vector<char>(SEGMENT_SIZE);
+    chunk(static_cast<unsigned>(SEGMENT_SIZE),
+          size_ - static_cast<std::size_t>(start),
+          [&](auto const, auto const s) {
+            verify(std::fread(buf.data(), 1U, s, f_) == s, "invalid read");
+            hashes.emplace_back(hash(std::string_view{buf.data(), s}));
+          });
+    return hashes;
+  }
+
+  // Hash segments starting at `start` while writing (see segment_tracker).
+  void track_segments(offset_t const start) {
+    verify(static_cast<std::size_t>(start) == size_,
+           "track segments: not at end");
+    segments_.begin(size_);
+  }
+
   template <typename T>
   void write(std::size_t const pos, T const& val) {
     verify(!std::fseek(f_, static_cast<long>(pos), SEEK_SET), "seek error");
     verify(std::fwrite(reinterpret_cast<std::uint8_t const*>(&val), 1U,
                        serialized_size<T>(), f_) == serialized_size<T>(),
            "write error");
+    segments_.patched(pos, &val, serialized_size<T>());
   }
 
   offset_t write(void const* ptr, std::size_t const size,
@@ -313,12 +387,15 @@ struct file {
     }
     verify(!std::fseek(f_, seek_offset, seek_whence), "seek error");
     verify(std::fwrite(ptr, 1U, size, f_) == size, "write error");
+    segments_.appended(nullptr, curr_offset - size_);
+    segments_.appended(ptr, size);
     size_ = curr_offset + size;
     return static_cast<offset_t>(curr_offset);
   }
 
   FILE* f_{nullptr};
   std::size_t size_{0U};
+  streamed_segments segments_;
 };
 
 }  // namespace cista
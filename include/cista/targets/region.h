@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+
+#include "cista/offset_t.h"
+#include "cista/serialized_size.h"
+#include "cista/verify.h"
+
+namespace cista {
+
+// Target that appends to the fixed region [start, end) of a pre-allocated
+// buffer of `size` bytes. Positional writes may hit the whole buffer.
+// Multiple regions of the same buffer can be written concurrently.
+struct region {
+  region(std::uint8_t* base, std::size_t const size, std::size_t const start,
+         std::size_t const end)
+      : base_{base}, size_{size}, pos_{start}, end_{end} {}
+
+  template <typename T>
+  void write(std::size_t const pos, T const& val) {
+    verify(size_ >= pos + serialized_size<T>(), "out of bounds write");
+    std::memcpy(base_ + pos, &val, serialized_size<T>());
+  }
+
+  offset_t write(void const* ptr, std::size_t const num_bytes,
+                 std::size_t const alignment = 0U) {
+    auto start = pos_;
+    if (alignment > 1U) {
+      start = (start + alignment - 1U) & ~(alignment - 1U);
+    }
+    verify(start + num_bytes <= end_, "region overflow");
+    std::memcpy(base_ + start, ptr, num_bytes);
+    pos_ = start + num_bytes;
+    return static_cast<offset_t>(start);
+  }
+
+  std::size_t size() const noexcept { return pos_; }
+
+  std::uint8_t* base_;
+  std::size_t size_;
+  std::size_t pos_, end_;
+};
+
+}  // namespace cista
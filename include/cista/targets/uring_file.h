@@ -0,0 +1,295 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "cista/targets/buffered_file.h"
+#include "cista/verify.h"
+
+namespace cista {
+
+// Minimal io_uring submission/completion queue (raw syscalls, no liburing).
+// Single producer, single consumer: only used from one thread.
+struct uring {
+  uring() = default;
+
+  ~uring() {
+    if (sqes_ != nullptr) {
+      ::munmap(sqes_, sqes_size_);
+    }
+    if (cq_ptr_ != nullptr && cq_ptr_ != sq_ptr_) {
+      ::munmap(cq_ptr_, cq_size_);
+    }
+    if (sq_ptr_ != nullptr) {
+      ::munmap(sq_ptr_, sq_size_);
+    }
+    if (fd_ != -1) {
+      ::close(fd_);
+    }
+  }
+
+  uring(uring const&) = delete;
+  uring& operator=(uring const&) = delete;
+  uring(uring&&) = delete;
+  uring& operator=(uring&&) = delete;
+
+  // Returns false if io_uring is not available (old kernel, seccomp, ...).
+  bool init(unsigned const entries) {
+    auto p = io_uring_params{};
+    fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+    if (fd_ == -1) {
+      return false;
+    }
+
+    sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    auto const single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0U;
+    if (single_mmap) {
+      sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+    }
+
+    sq_ptr_ = map(sq_size_, IORING_OFF_SQ_RING);
+    if (sq_ptr_ == nullptr) {
+      return false;
+    }
+    cq_ptr_ = single_mmap ? sq_ptr_ : map(cq_size_, IORING_OFF_CQ_RING);
+    sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+    if (cq_ptr_ == nullptr || sqes_ == nullptr) {
+      return false;
+    }
+
+    auto const sq = static_cast<std::uint8_t*>(sq_ptr_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+
+    auto const cq = static_cast<std::uint8_t*>(cq_ptr_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+    return true;
+  }
+
+  void* map(std::size_t const size, std::uint64_t const offset) const {
+    auto const ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd_,
+                            static_cast<off_t>(offset));
+    return ptr == MAP_FAILED ? nullptr : ptr;
+  }
+
+  void submit_write(int const fd, void const* buf, std::size_t const size,
+                    std::size_t const pos, std::uint64_t const user_data) {
+    auto const tail = *sq_tail_;
+    auto const idx = tail & sq_mask_;
+    auto& sqe = sqes_[idx];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_WRITE;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<std::uint64_t>(buf);
+    sqe.len = static_cast<std::uint32_t>(size);
+    sqe.off = pos;
+    sqe.user_data = user_data;
+    sq_array_[idx] = idx;
+    __atomic_store_n(sq_tail_, tail + 1U, __ATOMIC_RELEASE);
+    verify(enter(1U, 0U, 0U) == 1, "io_uring submit error");
+  }
+
+  // Blocks until a completion is available.
+  io_uring_cqe wait_completion() {
+    while (true) {
+      auto const head = *cq_head_;
+      if (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        auto const cqe = cqes_[head & cq_mask_];
+        __atomic_store_n(cq_head_, head + 1U, __ATOMIC_RELEASE);
+        return cqe;
+      }
+      verify(enter(0U, 1U, IORING_ENTER_GETEVENTS) != -1,
+             "io_uring wait error");
+    }
+  }
+
+  int enter(unsigned const to_submit, unsigned const min_complete,
+            unsigned const flags) const {
+    while (true) {
+      auto const ret =
+          static_cast<int>(::syscall(__NR_io_uring_enter, fd_, to_submit,
+                                     min_complete, flags, nullptr, 0));
+      if (ret != -1 || errno != EINTR) {
+        return ret;
+      }
+    }
+  }
+
+  int fd_{-1};
+  void* sq_ptr_{nullptr};
+  void* cq_ptr_{nullptr};
+  std::size_t sq_size_{0U}, cq_size_{0U}, sqes_size_{0U};
+  io_uring_sqe* sqes_{nullptr};
+  unsigned* sq_tail_{nullptr};
+  unsigned* sq_array_{nullptr};
+  unsigned sq_mask_{0U};
+  unsigned* cq_head_{nullptr};
+  unsigned* cq_tail_{nullptr};
+  unsigned cq_mask_{0U};
+  io_uring_cqe* cqes_{nullptr};
+};
+
+// Writer of basic_buffered_file: keeps up to `num_buffers` buffers in flight
+// with io_uring while the next buffer is filled.
+//
+// Falls back to synchronous pwrite() if io_uring is not available.
+// With `direct_io`, full buffers bypass the page cache (O_DIRECT). Writes
+// that are not block aligned (the last buffer) use the regular descriptor.
+// If the file system does not support O_DIRECT, it is not used.
+struct uring_writer {
+  static constexpr auto const DIRECT_IO_ALIGNMENT = std::size_t{4096U};
+
+  struct options {
+    unsigned num_slots_{4U};
+    bool direct_io_{false};
+    bool use_io_uring_{true};
+  };
+
+  struct slot {
+    struct free_deleter {
+      void operator()(std::uint8_t* ptr) const noexcept { std::free(ptr); }
+    };
+    std::unique_ptr<std::uint8_t, free_deleter> data_;
+    std::size_t size_{0U}, pos_{0U};
+    bool in_flight_{false};
+  };
+
+  uring_writer(char const* path, int const fd, std::size_t const capacity,
+               options const& o)
+      : fd_{fd}, direct_fd_{fd} {
+    verify(o.num_slots_ != 0U, "uring_writer: no buffers");
+    verify(!o.direct_io_ || capacity % DIRECT_IO_ALIGNMENT == 0U,
+           "uring_writer: buffer size not block aligned");
+
+    if (o.direct_io_) {
+      auto const direct_fd = ::open(path, O_WRONLY | O_CLOEXEC | O_DIRECT);
+      if (direct_fd != -1) {
+        direct_fd_ = direct_fd;
+      }
+    }
+
+    slots_.resize(o.use_io_uring_ ? o.num_slots_ : 1U);
+    for (auto& b : slots_) {
+      void* mem = nullptr;
+      verify(::posix_memalign(&mem, DIRECT_IO_ALIGNMENT, capacity) == 0,
+             "uring_writer: out of memory");
+      b.data_.reset(static_cast<std::uint8_t*>(mem));
+    }
+
+    if (o.use_io_uring_ && slots_.size() > 1U) {
+      use_uring_ = ring_.init(static_cast<unsigned>(slots_.size()));
+    }
+    if (!use_uring_) {
+      slots_.resize(1U);
+    }
+  }
+
+  ~uring_writer() {
+    // Drain every write still in flight: the kernel may read the buffers
+    // until their completion is reaped. Errors can not be reported here.
+    while (in_flight_ != 0U) {
+      auto cqe = io_uring_cqe{};
+      try {
+        cqe = ring_.wait_completion();
+      } catch (...) {
+        break;  // ring unusable: closing it (before the buffers) cancels
+      }
+      try {
+        handle_completion(cqe);
+      } catch (...) {
+      }
+    }
+    if (direct_fd_ != fd_) {
+      ::close(direct_fd_);
+    }
+  }
+
+  uring_writer(uring_writer const&) = delete;
+  uring_writer& operator=(uring_writer const&) = delete;
+  uring_writer(uring_writer&&) = delete;
+  uring_writer& operator=(uring_writer&&) = delete;
+
+  std::uint8_t* buffer() noexcept { return slots_[current_].data_.get(); }
+
+  std::uint8_t* write(std::uint8_t*, std::size_t const size,
+                      std::size_t const pos) {
+    auto& b = slots_[current_];
+    b.size_ = size;
+    b.pos_ = pos;
+
+    auto const aligned = pos % DIRECT_IO_ALIGNMENT == 0U &&
+                         size % DIRECT_IO_ALIGNMENT == 0U;
+    auto const fd = aligned ? direct_fd_ : fd_;
+    if (!use_uring_) {
+      pwrite_all(fd, b.data_.get(), size, pos);
+    } else {
+      ring_.submit_write(fd, b.data_.get(), size, pos, current_);
+      b.in_flight_ = true;
+      ++in_flight_;
+    }
+
+    current_ = (current_ + 1U) % slots_.size();
+    while (slots_[current_].in_flight_) {
+      complete_one();
+    }
+    return buffer();
+  }
+
+  void wait() {
+    while (in_flight_ != 0U) {
+      complete_one();
+    }
+  }
+
+  void complete_one() { handle_completion(ring_.wait_completion()); }
+
+  void handle_completion(io_uring_cqe const& cqe) {
+    auto& b = slots_[static_cast<std::size_t>(cqe.user_data)];
+    b.in_flight_ = false;
+    --in_flight_;
+    if (cqe.res < 0) {
+      // IORING_OP_WRITE unsupported (kernel < 5.6) or O_DIRECT rejected.
+      verify(cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP,
+             "io_uring write error");
+      pwrite_all(fd_, b.data_.get(), b.size_, b.pos_);
+    } else if (static_cast<std::size_t>(cqe.res) < b.size_) {
+      auto const written = static_cast<std::size_t>(cqe.res);
+      pwrite_all(fd_, b.data_.get() + written, b.size_ - written,
+                 b.pos_ + written);
+    }
+  }
+
+  int fd_;
+  int direct_fd_;
+  std::vector<slot> slots_;  // destroyed after ring_: buffers outlive it
+  uring ring_;
+  bool use_uring_{false};
+  std::size_t current_{0U};
+  std::size_t in_flight_{0U};
+};
+
+// Target that writes with io_uring (see uring_writer and basic_buffered_file).
+using uring_file = basic_buffered_file<uring_writer>;
+
+}  // namespace cista
+
+#endif
@@ -186,11 +186,15 @@ constexpr auto static_type_hash(basic_unique_ptr<T, Ptr> const*,
 }
 
 template <typename T, template <typename> typename Ptr, typename GetKey,
-          typename GetValue, typename Hash, typename Eq, std::size_t NMaxTypes>
+          typename GetValue, typename Hash, typename Eq, std::size_t Width,
+          std::size_t NMaxTypes>
 constexpr auto static_type_hash(
-    hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq> const*,
+    hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq, Width> const*,
     hash_data<NMaxTypes> h) noexcept {
   h = h.combine(hash("hash_storage"));
+  if constexpr (Width != 8U) {  // 8 wide: hash of files without the width
+    h = h.combine(Width);
+  }
   return static_type_hash(null<T>(), h);
 }
 
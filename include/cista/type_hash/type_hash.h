@@ -104,10 +104,14 @@ hash_t type_hash(basic_unique_ptr<T, Ptr> const&, hash_t h,
 }
 
 template <typename T, template <typename> typename Ptr, typename GetKey,
-          typename GetValue, typename Hash, typename Eq>
-hash_t type_hash(hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq> const&,
-                 hash_t h, std::map<hash_t, unsigned>& done) noexcept {
+          typename GetValue, typename Hash, typename Eq, std::size_t Width>
+hash_t type_hash(
+    hash_storage<T, Ptr, GetKey, GetValue, Hash, Eq, Width> const&, hash_t h,
+    std::map<hash_t, unsigned>& done) noexcept {
   h = hash_combine(h, hash("hash_storage"));
+  if constexpr (Width != 8U) {  // 8 wide: hash of files without the width
+    h = hash_combine(h, Width);
+  }
   return type_hash(T{}, h, done);
 }
 
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <cinttypes>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "cista/memory_holder.h"
+#include "cista/mmap.h"
+#include "cista/mode.h"
+#include "cista/serialization.h"
+
+namespace cista {
+
+// Dataset that is replaced by newer versions while readers access it.
+//
+//   auto d = cista::versioned_dataset<T>{};
+//   d.load<MODE>("v1.bin");  // loader thread: map, verify, publish
+//   ...
+//   auto const s = d.acquire();  // reader thread: snapshot of the current
+//   s->member_;                  // version, valid until `s` is destroyed
+//
+// Two slots (current and previous version) with one reader count each. The
+// epoch selects the current slot. Readers increment the count of the
+// current slot and retry if the epoch changed meanwhile - no locks on the
+// read path. A version is destroyed (unmapped) only after its reader count
+// dropped to zero: at the next publish() (which waits for the readers of
+// the previous version) or with reclaim().
+//
+// The dataset has to outlive all snapshots.
+template <typename T>
+struct versioned_dataset {
+  struct version {
+    version(wrapped<T>&& data, std::uint64_t const number)
+        : data_{std::move(data)}, number_{number} {}
+
+    wrapped<T> data_;
+    std::uint64_t number_;
+  };
+
+  struct alignas(64) slot {
+    std::atomic_size_t readers_{0U};
+    std::unique_ptr<version> version_;
+  };
+
+  struct snapshot {
+    snapshot() = default;
+    explicit snapshot(slot* s) : slot_{s} {}
+
+    ~snapshot() { release(); }
+
+    snapshot(snapshot const&) = delete;
+    snapshot& operator=(snapshot const&) = delete;
+
+    snapshot(snapshot&& o) noexcept : slot_{o.slot_} { o.slot_ = nullptr; }
+
+    snapshot& operator=(snapshot&& o) noexcept {
+      release();
+      slot_ = o.slot_;
+      o.slot_ = nullptr;
+      return *this;
+    }
+
+    // nullptr if no version was published yet.
+    T const* get() const noexcept {
+      return slot_ == nullptr || slot_->version_ == nullptr
+                 ? nullptr
+                 : slot_->version_->data_.get();
+    }
+
+    T const* operator->() const noexcept { return get(); }
+    T const& operator*() const noexcept { return *get(); }
+    explicit operator bool() const noexcept { return get() != nullptr; }
+
+    // 0 if no version was published yet.
+    std::uint64_t version() const noexcept {
+      return get() == nullptr ? 0U : slot_->version_->number_;
+    }
+
+    void release() noexcept {
+      if (slot_ != nullptr) {
+        slot_->readers_.fetch_sub(1U, std::memory_order_release);
+        slot_ = nullptr;
+      }
+    }
+
+    slot* slot_{nullptr};
+  };
+
+  snapshot acquire() const noexcept {
+    while (true) {
+      auto const epoch = epoch_.load();
+      auto& s = slots_[epoch & 1U];
+      s.readers_.fetch_add(1U);
+      if (epoch_.load() == epoch) {
+        return snapshot{&s};
+      }
+      s.readers_.fetch_sub(1U, std::memory_order_release);
+    }
+  }
+
+  // Makes `data` the current version. Blocks until the readers of the
+  // version before the current one are gone. Returns the version number.
+  std::uint64_t publish(wrapped<T>&& data) {
+    auto const lock = std::lock_guard{publish_mutex_};
+    auto const epoch = epoch_.load();
+    auto& next = slots_[(epoch + 1U) & 1U];
+    while (next.readers_.load() != 0U) {
+      std::this_thread::yield();
+    }
+    next.version_ = std::make_unique<version>(std::move(data), ++number_);
+    epoch_.store(epoch + 1U);
+    reclaim_previous();
+    return number_;
+  }
+
+  // Maps and verifies the file (copy-on-write mapping: pages written by
+  // deserialize are not shared, the file stays untouched) and publishes it.
+  // Mapped files must not be modified: write new versions to a new file and
+  // rename() it over the old path.
+  template <mode const Mode = mode::NONE>
+  std::uint64_t load(char const* path) {
+    auto m = mmap{path, mmap::protection::PRIVATE};
+    auto const el = deserialize<T, Mode>(m);
+    return publish(wrapped<T>{buf<mmap>{std::move(m)}, el});
+  }
+
+  template <mode const Mode = mode::NONE>
+  std::future<std::uint64_t> load_async(std::string path) {
+    return std::async(std::launch::async, [this, p = std::move(path)]() {
+      return load<Mode>(p.c_str());
+    });
+  }
+
+  // Destroys the previous version if no reader holds it anymore.
+  // Returns true if no previous version is left.
+  bool reclaim() {
+    auto const lock = std::lock_guard{publish_mutex_};
+    return reclaim_previous();
+  }
+
+  // Number of the current version (0: nothing published).
+  std::uint64_t current_version() const noexcept {
+    return acquire().version();
+  }
+
+private:
+  bool reclaim_previous() {
+    auto& previous = slots_[(epoch_.load() + 1U) & 1U];
+    if (previous.version_ == nullptr) {
+      return true;
+    }
+    // seq_cst (like acquire()): a reader that incremented after this load
+    // sees the new epoch_ and backs off (store-load ordering).
+    if (previous.readers_.load() != 0U) {
+      return false;
+    }
+    previous.version_.reset();
+    return true;
+  }
+
+  mutable slot slots_[2];
+  std::atomic_uint64_t epoch_{0U};
+  std::mutex publish_mutex_;
+  std::uint64_t number_{0U};
+};
+
+}  // namespace cista
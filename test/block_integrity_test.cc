@@ -0,0 +1,163 @@
+#include "doctest.h"
+
+#ifdef SINGLE_HEADER
+#include "cista.h"
+#else
+#include "cista/serialization.h"
+#endif
+
+namespace block_integrity_test {
+
+namespace data = cista::offset;
+
+// Records of one and a half blocks: each one spans a block boundary.
+struct dataset {
+  std::uint32_t id_{0U};
+  data::vector<data::vector<std::uint8_t>> records_;
+  data::vector<std::uint64_t> values_;
+};
+
+constexpr auto const RECORD_SIZE = 3U * cista::SEGMENT_SIZE / 2U;
+
+dataset make_dataset() {
+  auto d = dataset{};
+  d.id_ = 7U;
+  for (auto i = 0U; i != 4U; ++i) {
+    d.records_.emplace_back(
+        data::vector<std::uint8_t>(RECORD_SIZE, static_cast<std::uint8_t>(i)));
+  }
+  for (auto i = 0U; i != 100'000U; ++i) {
+    d.values_.emplace_back(i);
+  }
+  return d;
+}
+
+constexpr auto const MODE =
+    cista::mode::WITH_VERSION | cista::mode::WITH_BLOCK_INTEGRITY;
+
+}  // namespace block_integrity_test
+
+using namespace block_integrity_test;
+
+TEST_CASE("block integrity round trip") {
+  auto d = make_dataset();
+  auto buf = cista::serialize<MODE>(d);
+  CHECK(buf.size() == cista::serialized_size_of<MODE>(d));
+
+  auto const e = cista::deserialize<dataset, MODE>(buf);
+  CHECK(e->id_ == 7U);
+  REQUIRE(e->records_.size() == 4U);
+  CHECK(e->records_[3U].size() == RECORD_SIZE);
+  CHECK(e->records_[3U][RECORD_SIZE - 1U] == 3U);
+  CHECK(e->values_.size() == 100'000U);
+  CHECK(e->values_[99'999U] == 99'999U);
+}
+
+TEST_CASE("block integrity walk detects corruption") {
+  auto d = make_dataset();
+  auto buf = cista::serialize<MODE>(d);
+  buf[cista::data_start(MODE) + buf.size() / 2U] ^= 0x01U;
+  CHECK_THROWS(cista::deserialize<dataset, MODE>(buf));
+}
+
+TEST_CASE("block integrity corrupted table") {
+  auto d = make_dataset();
+  auto buf = cista::serialize<MODE>(d);
+  buf[buf.size() - sizeof(std::uint64_t) - 1U] ^= 0x01U;
+  CHECK_THROWS(cista::check<dataset, MODE>(buf.data(),
+                                           buf.data() + buf.size()));
+}
+
+TEST_CASE("block integrity on demand") {
+  auto d = make_dataset();
+  auto buf = cista::serialize<MODE>(d);
+  auto const from = buf.data();
+  auto const to = buf.data() + buf.size();
+
+  auto integrity = cista::make_block_integrity<MODE>(from, to);
+  auto const e = cista::deserialize<dataset, MODE | cista::mode::UNCHECKED>(
+      from, to, integrity);
+  CHECK(integrity.num_blocks() > 4U);
+  CHECK(integrity.num_verified() < integrity.num_blocks());
+
+  // Corrupt the last value (not verified by the unchecked walk).
+  e->values_[99'999U] ^= 0x01U;
+
+  CHECK_NOTHROW(
+      integrity.check(&e->values_[0U], 1'000U * sizeof(std::uint64_t)));
+  CHECK_THROWS(integrity.check(&e->values_[99'999U], sizeof(std::uint64_t)));
+  CHECK_THROWS(integrity.check(e->values_.data(), buf.size()));
+}
+
+TEST_CASE("block integrity check across a block boundary") {
+  auto d = make_dataset();
+  auto buf = cista::serialize<MODE>(d);
+  auto const from = buf.data();
+  auto const to = buf.data() + buf.size();
+
+  auto integrity = cista::make_block_integrity<MODE>(from, to);
+  auto const e = cista::deserialize<dataset, MODE | cista::mode::UNCHECKED>(
+      from, to, integrity);
+
+  // Only the block holding the last byte of the record is corrupted.
+  auto& record = e->records_[1U];
+  record[RECORD_SIZE - 1U] ^= 0x01U;
+
+  CHECK_NOTHROW(integrity.check(record.data(), 1U));
+  CHECK_THROWS(integrity.check(record.data(), RECORD_SIZE));
+}
+
+TEST_CASE("block integrity eager") {
+  auto d = make_dataset();
+  auto buf = cista::serialize<MODE>(d);
+  auto const from = buf.data();
+  auto const to = buf.data() + buf.size();
+
+  auto integrity = cista::make_block_integrity<MODE>(from, to);
+  integrity.check_async(4U).get();
+  CHECK(integrity.num_verified() == integrity.num_blocks());
+
+  buf[buf.size() / 2U] ^= 0x01U;
+  auto corrupted = cista::make_block_integrity<MODE>(from, to);
+  CHECK_THROWS(corrupted.check_async(4U).get());
+}
+
+TEST_CASE("block integrity with relocations") {
+  namespace raw = cista::raw;
+  struct node {
+    raw::vector<std::uint64_t> values_;
+    raw::string name_;
+  };
+
+  auto n = node{};
+  for (auto i = 0U; i != 50'000U; ++i) {
+    n.values_.emplace_back(i);
+  }
+  n.name_ = "a raw string on the heap, relocated";
+
+  constexpr auto const RELOCATIONS_MODE =
+      cista::mode::WITH_BLOCK_INTEGRITY | cista::mode::WITH_RELOCATIONS;
+  auto buf = cista::serialize<RELOCATIONS_MODE>(n);
+  CHECK(buf.size() == cista::serialized_size_of<RELOCATIONS_MODE>(n));
+
+  auto const e = cista::deserialize<node, RELOCATIONS_MODE>(buf);
+  CHECK(e->values_.size() == 50'000U);
+  CHECK(e->values_[49'999U] == 49'999U);
+  CHECK(e->name_ == "a raw string on the heap, relocated");
+}
+
+TEST_CASE("block integrity file target") {
+  constexpr auto const FILENAME = "block_integrity.bin";
+
+  auto d = make_dataset();
+  {
+    cista::file f{FILENAME, "w+"};
+    cista::serialize<MODE>(f, d);
+  }
+
+  auto b = cista::file(FILENAME, "r").content();
+  CHECK(cista::serialize<MODE>(d) ==
+        cista::byte_buf{b.data(), b.data() + b.size()});
+  auto const e = cista::deserialize<dataset, MODE>(b);
+  CHECK(e->values_.size() == 100'000U);
+}
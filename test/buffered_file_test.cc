@@ -0,0 +1,116 @@
+#ifndef _WIN32
+
+#include "doctest.h"
+
+#ifdef SINGLE_HEADER
+#include "cista.h"
+#else
+#include "cista/serialization.h"
+#include "cista/targets/buffered_file.h"
+#endif
+
+namespace buffered_file_test {
+
+namespace data = cista::offset;
+
+struct node {
+  data::vector<data::ptr<node>> edges_;
+  data::string name_;
+  std::uint32_t id_{0U};
+};
+
+struct graph {
+  data::vector<data::unique_ptr<node>> nodes_;
+  data::vector<data::vector<std::uint32_t>> groups_;
+};
+
+graph make_graph() {
+  auto g = graph{};
+  for (auto i = 0U; i != 1'000U; ++i) {
+    g.nodes_.emplace_back(data::make_unique<node>(
+        node{{}, data::string{"a node name that is not short"}, i}));
+  }
+  for (auto i = 0U; i != 1'000U; ++i) {
+    g.nodes_[i]->edges_.emplace_back(g.nodes_[(i * 7U) % 1'000U].get());
+    g.nodes_[i]->edges_.emplace_back(g.nodes_[(i + 999U) % 1'000U].get());
+  }
+  for (auto i = 0U; i != 2'000U; ++i) {
+    g.groups_.emplace_back(data::vector<std::uint32_t>{i, i + 1U, i + 2U});
+  }
+  return g;
+}
+
+cista::byte_buf read_file(char const* path) {
+  auto b = cista::file{path, "r"}.content();
+  return cista::byte_buf{b.data(), b.data() + b.size()};
+}
+
+template <cista::mode Mode>
+void check_same_output(std::size_t const buffer_size) {
+  constexpr auto const FILENAME = "buffered_file.bin";
+  auto g = make_graph();
+  {
+    auto f = cista::buffered_file{FILENAME, buffer_size};
+    cista::serialize<Mode>(f, g);
+  }
+  auto const expected = cista::serialize<Mode>(g);
+  auto b = read_file(FILENAME);
+  CHECK(b == expected);
+
+  auto const d = cista::deserialize<graph, Mode>(b);
+  CHECK(d->nodes_.size() == 1'000U);
+  CHECK(d->nodes_[5U]->edges_[0U]->id_ == 35U);
+  CHECK(d->groups_[1'999U][2U] == 2'001U);
+}
+
+}  // namespace buffered_file_test
+
+using namespace buffered_file_test;
+
+TEST_CASE("buffered_file output equals buf output") {
+  for (auto const buffer_size : {std::size_t{64U}, std::size_t{4096U},
+                                 cista::buffered_file::DEFAULT_BUFFER_SIZE}) {
+    check_same_output<cista::mode::NONE>(buffer_size);
+    check_same_output<cista::mode::WITH_VERSION |
+                      cista::mode::WITH_INTEGRITY>(buffer_size);
+    check_same_output<cista::mode::WITH_SEGMENTED_INTEGRITY>(buffer_size);
+    check_same_output<cista::mode::WITH_BLOCK_INTEGRITY>(buffer_size);
+  }
+}
+
+TEST_CASE("buffered_file batched patches") {
+  constexpr auto const FILENAME = "buffered_file_patches.bin";
+  {
+    auto f = cista::buffered_file{
+        FILENAME, 16U, cista::buffered_file::durability::SYNC_ON_CLOSE};
+    auto const zeros = std::array<std::uint8_t, 64U>{};
+    f.write(zeros.data(), zeros.size(), 0U);  // larger than the buffer
+    f.write(zeros.data(), 8U, 0U);  // buffered: [64, 72[
+    f.write(std::size_t{8U}, std::uint64_t{1U});
+    f.write(std::size_t{4U}, std::uint64_t{2U});  // overlaps, written later
+    f.write(std::size_t{16U}, std::uint32_t{3U});  // adjacent
+    f.write(std::size_t{60U}, std::uint64_t{4U});  // partially buffered
+    CHECK(f.patches_.size() == 4U);
+    CHECK(f.patch_bytes_.size() == 24U);
+    f.close();
+  }
+
+  auto const b = read_file(FILENAME);
+  REQUIRE(b.size() == 72U);
+  auto const u64 = [&](std::size_t const pos) {
+    auto v = std::uint64_t{};
+    std::memcpy(&v, &b[pos], sizeof(v));
+    return v;
+  };
+  auto const u32 = [&](std::size_t const pos) {
+    auto v = std::uint32_t{};
+    std::memcpy(&v, &b[pos], sizeof(v));
+    return v;
+  };
+  CHECK(u64(4U) == 2U);
+  CHECK(u32(12U) == 0U);
+  CHECK(u32(16U) == 3U);
+  CHECK(u64(60U) == 4U);
+}
+
+#endif
@@ -1,4 +1,13 @@
 #define DOCTEST_CONFIG_NO_EXCEPTIONS
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include "doctest.h"
 
 #ifdef SINGLE_HEADER
@@ -220,4 +229,402 @@ TEST_CASE("string view get") {
   CHECK(s.erase(string{"2"}) == 0);
   CHECK(s.erase("2") == 0);
 }
-#endif
\ No newline at end of file
+#endif
+TEST_CASE("hash_set group match is exact") {
+  using set_t = cista::raw::hash_set<int>;
+  using ctrl_t = set_t::ctrl_t;
+
+  // 0x13 ^ 0x12 == 0x01 next to a match: false positive for the classic
+  // SWAR (x - LSBS) & ~x & MSBS zero byte test.
+  ctrl_t const ctrl[] = {ctrl_t{0x13},    ctrl_t{0x12},    set_t::EMPTY,
+                         set_t::DELETED,  ctrl_t{0x13},    ctrl_t{0x00},
+                         ctrl_t{0x7F},    set_t::END};
+  auto const g = set_t::group{ctrl};
+
+  auto matches = std::vector<std::size_t>{};
+  for (auto const i : g.match(0x13U)) {
+    matches.push_back(i);
+  }
+  CHECK(matches == std::vector<std::size_t>{0U, 4U});
+
+  matches.clear();
+  for (auto const i : g.match(0x00U)) {
+    matches.push_back(i);
+  }
+  CHECK(matches == std::vector<std::size_t>{5U});
+
+  CHECK(!g.match(0x01U));
+  CHECK(*g.match_empty() == 2U);
+  CHECK(*g.match_empty_or_deleted() == 2U);
+}
+
+TEST_CASE("hash_map find_batch") {
+  auto uut = cista::raw::hash_map<int, int>{};
+  auto keys = std::vector<int>{};
+  for (auto i = 0; i != 1000; ++i) {
+    uut.emplace(i, i + 1);
+    keys.push_back(i);
+    keys.push_back(-i - 1);  // not found
+  }
+  for (auto i = 0; i < 1000; i += 3) {
+    uut.erase(i);
+  }
+
+  auto found = std::vector<decltype(uut)::iterator>(keys.size());
+  CHECK(uut.find_batch(begin(keys), end(keys), begin(found)) == end(found));
+  auto contained = std::vector<bool>{};
+  uut.contains_batch(begin(keys), end(keys), std::back_inserter(contained));
+  CHECK(contained.size() == keys.size());
+  for (auto i = 0U; i != keys.size(); ++i) {
+    CHECK(found[i] == uut.find(keys[i]));
+    CHECK(contained[i] == (uut.find(keys[i]) != uut.end()));
+  }
+
+  auto const& const_uut = uut;
+  auto const_found = std::vector<decltype(uut)::const_iterator>{};
+  const_uut.find_batch(begin(keys), end(keys), std::back_inserter(const_found));
+  CHECK(const_found.size() == keys.size());
+  CHECK(const_found[2] == const_uut.find(1));
+  CHECK(const_found[2]->second == 2);
+
+  auto const empty = cista::raw::hash_map<int, int>{};
+  auto empty_contained = std::vector<bool>{};
+  empty.contains_batch(begin(keys), end(keys),
+                       std::back_inserter(empty_contained));
+  CHECK(std::count(begin(empty_contained), end(empty_contained), true) == 0);
+}
+
+TEST_CASE("deserialized hash_map find_batch") {
+  namespace data = cista::offset;
+  using map_t = data::hash_map<data::string, int>;
+
+  auto buf = cista::byte_buf{};
+  {
+    auto m = map_t{};
+    for (auto i = 0; i != 100; ++i) {
+      m.emplace(data::string{"key" + std::to_string(i)}, i);
+    }
+    buf = cista::serialize(m);
+  }
+
+  auto const m = cista::deserialize<map_t>(buf);
+  auto const keys = std::vector<std::string_view>{"key0", "key99", "key100",
+                                                  "key42", ""};
+  auto found = std::vector<map_t::const_iterator>{};
+  m->find_batch(begin(keys), end(keys), std::back_inserter(found));
+  CHECK(found.size() == keys.size());
+  CHECK(found[0]->second == 0);
+  CHECK(found[1]->second == 99);
+  CHECK(found[2] == m->end());
+  CHECK(found[3]->second == 42);
+  CHECK(found[4] == m->end());
+}
+
+TEST_CASE("hash_map reserve") {
+  auto uut = cista::raw::hash_map<int, int>{};
+  uut.reserve(0U);
+  CHECK(uut.capacity() == 0U);
+
+  for (auto const n : {1U, 6U, 7U, 8U, 100U, 1000U, 4096U}) {
+    uut.clear();
+    uut.reserve(n);
+    auto const capacity = uut.capacity();
+    CHECK(capacity >= n);
+    for (auto i = 0; i != static_cast<int>(n); ++i) {
+      uut.emplace(i, i);
+    }
+    CHECK(uut.capacity() == capacity);
+    CHECK(uut.size() == n);
+  }
+
+  auto const capacity = uut.capacity();
+  uut.reserve(10U);
+  CHECK(uut.capacity() == capacity);
+  CHECK(uut.find(4095)->second == 4095);
+}
+
+TEST_CASE("hash_map try_emplace") {
+  namespace data = cista::raw;
+
+  static auto constructed = 0U;
+  struct counted {
+    explicit counted(int const v) : v_{v} { ++constructed; }
+    int v_;
+  };
+
+  auto uut = data::hash_map<data::string, counted>{};
+  auto const a = uut.try_emplace(std::string_view{"a"}, 1);
+  CHECK(a.second);
+  CHECK(a.first->second.v_ == 1);
+  CHECK(constructed == 1U);
+
+  auto const b = uut.try_emplace(std::string_view{"a"}, 2);
+  CHECK(!b.second);
+  CHECK(b.first == a.first);
+  CHECK(b.first->second.v_ == 1);
+  CHECK(constructed == 1U);
+
+  CHECK(uut.try_emplace(data::string{"long string, not inlined ....."}, 3)
+            .second);
+  CHECK(uut.at(std::string_view{"long string, not inlined ....."}).v_ == 3);
+  CHECK(uut.size() == 2U);
+  CHECK(constructed == 2U);
+}
+
+TEST_CASE("hash_map try_emplace constructs in place") {
+  namespace data = cista::raw;
+
+  auto uut = data::hash_map<int, data::vector<int>>{};
+  CHECK(uut.try_emplace(1, 3U, 0).second);
+  CHECK(uut.at(1) == data::vector<int>{0, 0, 0});
+}
+
+TEST_CASE("hash_map try_emplace throwing constructor") {
+  namespace data = cista::raw;
+
+  struct throwing {
+    explicit throwing(bool const fail) {
+      if (fail) {
+        throw std::runtime_error{"fail"};
+      }
+    }
+  };
+
+  auto uut = data::hash_map<int, throwing>{};
+  auto thrown = false;
+  try {
+    uut.try_emplace(1, true);
+  } catch (std::runtime_error const&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  CHECK(uut.size() == 0U);
+  CHECK(uut.find(1) == uut.end());
+  CHECK(uut.begin() == uut.end());
+
+  CHECK(uut.try_emplace(1, false).second);
+  CHECK(uut.size() == 1U);
+  CHECK(uut.find(1) != uut.end());
+}
+
+TEST_CASE("hash_map bulk insert") {
+  using map_t = cista::raw::hash_map<int, int>;
+  auto entries = std::vector<map_t::entry_t>{};
+  for (auto i = 0; i != 1000; ++i) {
+    entries.push_back({i, i * 2});
+  }
+  entries.push_back({5, -1});  // duplicate: the first entry wins
+
+  auto uut = map_t{};
+  uut.emplace(5, 5);
+  uut.emplace(2000, 2000);
+  uut.insert(begin(entries), end(entries));
+  CHECK(uut.size() == 1001U);
+  CHECK(uut.at(5) == 5);
+  CHECK(uut.at(999) == 1998);
+  CHECK(uut.at(2000) == 2000);
+  for (auto i = 0; i != 1000; ++i) {
+    CHECK(uut.find(i) != uut.end());
+  }
+
+  auto const copy = uut;
+  CHECK(copy == uut);
+
+  auto set = cista::raw::hash_set<int>{3, 1, 4, 1, 5, 9, 2, 6};
+  CHECK(set.size() == 7U);
+  auto in = std::istringstream{"5 8 9 7"};
+  set.insert(std::istream_iterator<int>{in}, std::istream_iterator<int>{});
+  CHECK(set.size() == 9U);
+  CHECK(set.find(8) != set.end());
+}
+
+TEST_CASE("hash_map erase churn does not grow") {
+  using map_t = cista::raw::hash_map<int, int>;
+  auto uut = map_t{};
+  for (auto i = 0; i != 1000; ++i) {
+    uut.emplace(i, i);
+  }
+  auto const capacity = uut.capacity_;
+
+  // Sliding window of 1000 keys: every insert needs a new slot.
+  for (auto i = 1000; i != 200'000; ++i) {
+    uut.erase(i - 1000);
+    uut.emplace(i, i);
+  }
+  CHECK(uut.capacity_ == capacity);
+  CHECK(uut.size() == 1000U);
+  for (auto i = 199'000; i != 200'000; ++i) {
+    auto const it = uut.find(i);
+    CHECK((it != uut.end() && it->second == i));
+  }
+  CHECK(uut.find(198'999) == uut.end());
+  CHECK(std::distance(begin(uut), end(uut)) == 1000);
+}
+
+TEST_CASE("hash_map shrink_to_fit and rehash") {
+  namespace data = cista::raw;
+  auto uut = data::hash_map<data::string, int>{};
+  for (auto i = 0; i != 10'000; ++i) {
+    uut.emplace("long key, not stored inline " + std::to_string(i), i);
+  }
+  for (auto i = 10; i != 10'000; ++i) {
+    uut.erase(data::string{"long key, not stored inline " +
+                           std::to_string(i)});
+  }
+
+  uut.shrink_to_fit();
+  CHECK(uut.size() == 10U);
+  CHECK(uut.capacity_ == 15U);
+  CHECK(uut.growth_left_ == uut.capacity_to_growth(15U) - 10U);
+  for (auto i = 0; i != 10; ++i) {
+    CHECK(uut.at(data::string{"long key, not stored inline " +
+                              std::to_string(i)}) == i);
+  }
+
+  uut.rehash(100U);
+  CHECK(uut.capacity_ == 127U);
+  CHECK(uut.size() == 10U);
+
+  uut.rehash(1U);
+  CHECK(uut.capacity_ == 15U);
+
+  uut.clear();
+  uut.emplace("a", 1);
+  uut.erase(data::string{"a"});
+  uut.shrink_to_fit();
+  CHECK(uut.capacity_ == 0U);
+  CHECK(uut.empty());
+  uut.emplace("b", 2);
+  CHECK(uut.at(data::string{"b"}) == 2);
+}
+
+namespace hash_set_width_test {
+
+template <std::size_t Width>
+void check_group() {
+  using set_t = cista::raw::hash_set<int, cista::hashing<int>,
+                                     cista::equal_to<int>, Width>;
+  using ctrl_t = typename set_t::ctrl_t;
+
+  auto ctrl = std::vector<ctrl_t>(Width, set_t::DELETED);
+  ctrl[1] = set_t::EMPTY;
+  ctrl[2] = ctrl_t{0x13};
+  ctrl[3] = ctrl_t{0x12};
+  ctrl[Width - 2U] = ctrl_t{0x13};
+  ctrl[Width - 1U] = set_t::END;
+  auto const g = typename set_t::group{ctrl.data()};
+
+  auto matches = std::vector<std::size_t>{};
+  for (auto const i : g.match(0x13U)) {
+    matches.push_back(i);
+  }
+  CHECK(matches == std::vector<std::size_t>{2U, Width - 2U});
+  CHECK(!g.match(0x01U));
+  CHECK(*g.match_empty() == 1U);
+  CHECK(g.match_empty().leading_zeros() == Width - 2U);
+
+  matches.clear();
+  for (auto const i : g.match_empty_or_deleted()) {
+    matches.push_back(i);
+  }
+  CHECK(matches.size() == Width - 4U);
+  CHECK(matches.front() == 0U);
+  CHECK(matches.back() == Width - 3U);
+  CHECK(g.count_leading_empty_or_deleted() == 2U);
+
+  std::fill(begin(ctrl), end(ctrl), set_t::EMPTY);
+  CHECK(typename set_t::group{ctrl.data()}.count_leading_empty_or_deleted() ==
+        Width);
+}
+
+template <std::size_t Width>
+void check_map() {
+  namespace data = cista::offset;
+  using map_t = data::hash_map<data::string, int, cista::hashing<data::string>,
+                               cista::equal_to<data::string>, Width>;
+  auto const key = [](int const i) {
+    return data::string{"long key, not stored inline " + std::to_string(i)};
+  };
+
+  auto buf = cista::byte_buf{};
+  {
+    auto m = map_t{};
+    for (auto i = 0; i != 3; ++i) {  // capacity < Width
+      m.emplace(key(i), i);
+    }
+    CHECK(m.capacity_ < Width);
+    CHECK(m.at(key(2)) == 2);
+    CHECK(m.find(key(3)) == m.end());
+
+    for (auto round = 0; round != 3; ++round) {
+      for (auto i = 0; i != 2'000; ++i) {
+        m.emplace(key(i), i);
+      }
+      for (auto i = 0; i < 2'000; i += 3) {
+        CHECK(m.erase(key(i)) == 1U);
+      }
+    }
+    CHECK(m.size() == 2'000U - 667U);
+    auto n = std::size_t{0U};
+    for (auto const& [k, v] : m) {
+      CHECK(v % 3 != 0);
+      CHECK(m.at(k) == v);
+      ++n;
+    }
+    CHECK(n == m.size());
+  }
+
+  {
+    auto m = map_t{};
+    for (auto i = 0; i != 2'000; ++i) {
+      m.emplace(key(i), i);
+    }
+    buf = cista::serialize<cista::mode::WITH_VERSION>(m);
+  }
+
+  auto const m = cista::deserialize<map_t, cista::mode::WITH_VERSION>(buf);
+  CHECK(m->size() == 2'000U);
+  auto const keys = std::vector<data::string>{key(0), key(2'000), key(1'999)};
+  auto found = std::vector<typename map_t::const_iterator>{};
+  m->find_batch(begin(keys), end(keys), std::back_inserter(found));
+  CHECK(found[0]->second == 0);
+  CHECK(found[1] == m->end());
+  CHECK(found[2]->second == 1'999);
+
+  // Another width has another ctrl layout and probe sequence.
+  using narrow_t = data::hash_map<data::string, int>;
+  auto rejected = false;
+  try {
+    cista::deserialize<narrow_t, cista::mode::WITH_VERSION>(buf);
+  } catch (std::exception const&) {
+    rejected = true;
+  }
+  CHECK(rejected);
+}
+
+}  // namespace hash_set_width_test
+
+TEST_CASE("hash_set wide groups match exactly") {
+  hash_set_width_test::check_group<16U>();
+  hash_set_width_test::check_group<32U>();
+
+  // Portable lane (used without SSE2): one bit per byte.
+  std::uint8_t const bytes[] = {0x13U, 0x12U, 0x80U, 0xFEU,
+                                0x13U, 0x00U, 0x7FU, 0xFFU};
+  auto const lane = cista::detail::swar_lane::load(bytes);
+  CHECK(cista::detail::swar_lane::match(lane, 0x13U) == 0b0001'0001U);
+  CHECK(cista::detail::swar_lane::match(lane, 0x00U) == 0b0010'0000U);
+  CHECK(cista::detail::swar_lane::match(lane, 0x80U) == 0b0000'0100U);
+  CHECK(cista::detail::swar_lane::match_empty_or_deleted(lane) ==
+        0b0000'1100U);
+}
+
+TEST_CASE("hash_map wide groups") {
+  hash_set_width_test::check_map<16U>();
+  hash_set_width_test::check_map<32U>();
+
+  namespace data = cista::offset;
+  CHECK(cista::type_hash<data::hash_map<int, int>>() !=
+        cista::type_hash<data::hash_map<int, int, cista::hashing<int>,
+                                        cista::equal_to<int>, 16U>>());
+}
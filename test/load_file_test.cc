@@ -0,0 +1,126 @@
+#ifndef _WIN32
+
+#include "doctest.h"
+
+#ifdef SINGLE_HEADER
+#include "cista.h"
+#else
+#include "cista/load_file.h"
+#include "cista/serialization.h"
+#endif
+
+namespace load_file_test {
+
+namespace data = cista::offset;
+
+// 24 byte records: the chunk boundaries (multiples of SEGMENT_SIZE) cut
+// through records and the last chunk is a partial one.
+struct record {
+  std::uint64_t index_{0U}, square_{0U}, checksum_{0U};
+};
+
+struct dataset {
+  std::uint32_t id_{0U};
+  data::vector<record> records_;
+};
+
+constexpr auto const NUM_RECORDS =
+    5U * cista::SEGMENT_SIZE / sizeof(record) + 3U;
+
+record make_record(std::uint64_t const i) { return {i, i * i, i ^ 0xABCDU}; }
+
+dataset make_dataset() {
+  auto d = dataset{};
+  d.id_ = 3U;
+  for (auto i = std::uint64_t{0U}; i != NUM_RECORDS; ++i) {
+    d.records_.emplace_back(make_record(i));
+  }
+  return d;
+}
+
+bool operator==(record const& a, record const& b) {
+  return a.index_ == b.index_ && a.square_ == b.square_ &&
+         a.checksum_ == b.checksum_;
+}
+
+// Small chunks: many chunks, segments hashed by different threads.
+cista::load_options const small_chunks{4U, cista::SEGMENT_SIZE, false};
+
+template <cista::mode Mode>
+void check_load(char const* path) {
+  auto d = make_dataset();
+  {
+    auto f = cista::file{path, "w+"};
+    cista::serialize<Mode>(f, d);
+  }
+
+  for (auto const& o : {cista::load_options{}, small_chunks}) {
+    auto const e = cista::load<dataset, Mode>(path, o);
+    CHECK(reinterpret_cast<std::uintptr_t>(
+              std::get<cista::buffer>(e.mem_).data()) %
+              cista::HUGE_PAGE_SIZE ==
+          0U);
+    CHECK(e->id_ == 3U);
+    REQUIRE(e->records_.size() == NUM_RECORDS);
+    auto const at_chunk_boundary = cista::SEGMENT_SIZE / sizeof(record);
+    CHECK(e->records_[at_chunk_boundary] == make_record(at_chunk_boundary));
+    CHECK(e->records_[NUM_RECORDS - 1U] == make_record(NUM_RECORDS - 1U));
+  }
+}
+
+template <cista::mode Mode>
+void check_corruption(char const* path) {
+  auto d = make_dataset();
+  auto buf = cista::serialize<Mode>(d);
+  buf[buf.size() / 3U] ^= 0x01U;
+  {
+    auto f = cista::file{path, "w+"};
+    f.write(buf.data(), buf.size(), 0U);
+  }
+  CHECK_THROWS(cista::load<dataset, Mode>(path, small_chunks));
+}
+
+}  // namespace load_file_test
+
+using namespace load_file_test;
+
+TEST_CASE("load_file equals file content") {
+  constexpr auto const FILENAME = "load_file.bin";
+
+  auto d = make_dataset();
+  {
+    auto f = cista::file{FILENAME, "w+"};
+    cista::serialize(f, d);
+  }
+  auto const expected = cista::file{FILENAME, "r"}.content();
+  auto const loaded = cista::load_file(FILENAME, small_chunks);
+  CHECK(std::string_view{reinterpret_cast<char const*>(loaded.data()),
+                         loaded.size()} ==
+        std::string_view{reinterpret_cast<char const*>(expected.data()),
+                         expected.size()});
+
+  { auto f = cista::file{FILENAME, "w+"}; }
+  CHECK(cista::load_file(FILENAME).size() == 0U);
+}
+
+TEST_CASE("load and verify") {
+  constexpr auto const FILENAME = "load_file_modes.bin";
+  check_load<cista::mode::NONE>(FILENAME);
+  check_load<cista::mode::WITH_VERSION | cista::mode::WITH_INTEGRITY>(
+      FILENAME);
+  check_load<cista::mode::WITH_VERSION |
+             cista::mode::WITH_SEGMENTED_INTEGRITY>(FILENAME);
+  check_load<cista::mode::WITH_VERSION | cista::mode::WITH_BLOCK_INTEGRITY>(
+      FILENAME);
+  check_load<cista::mode::WITH_BLOCK_INTEGRITY |
+             cista::mode::WITH_RELOCATIONS>(FILENAME);
+}
+
+TEST_CASE("load detects corruption") {
+  constexpr auto const FILENAME = "load_file_corrupted.bin";
+  check_corruption<cista::mode::WITH_INTEGRITY>(FILENAME);
+  check_corruption<cista::mode::WITH_SEGMENTED_INTEGRITY>(FILENAME);
+  check_corruption<cista::mode::WITH_BLOCK_INTEGRITY>(FILENAME);
+}
+
+#endif
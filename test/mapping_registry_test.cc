@@ -0,0 +1,129 @@
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "doctest.h"
+
+#ifdef SINGLE_HEADER
+#include "cista.h"
+#else
+#include "cista/mapping_registry.h"
+#include "cista/serialization.h"
+#endif
+
+#ifndef _WIN32
+
+namespace mapping_registry_test {
+
+namespace data = cista::offset;
+
+struct dataset {
+  std::uint64_t version_{0U};
+  data::vector<std::uint64_t> values_;
+};
+
+struct other_dataset {
+  std::uint64_t version_{0U};
+  data::vector<std::uint32_t> values_;
+};
+
+constexpr auto const MODE =
+    cista::mode::WITH_VERSION | cista::mode::WITH_INTEGRITY;
+
+void write(char const* path, std::uint64_t const version) {
+  auto const tmp = std::string{path} + ".tmp";
+  {
+    auto d = dataset{};
+    d.version_ = version;
+    d.values_.resize(100U, version);
+    auto f = cista::file{tmp.c_str(), "w+"};
+    cista::serialize<MODE>(f, d);
+  }
+  std::rename(tmp.c_str(), path);
+}
+
+}  // namespace mapping_registry_test
+
+using namespace mapping_registry_test;
+
+TEST_CASE("mapping registry shares mappings") {
+  constexpr auto const FILENAME = "mapping_registry.bin";
+  write(FILENAME, 1U);
+
+  auto r = cista::mapping_registry{};
+  auto a = r.open<dataset, MODE>(FILENAME);
+  auto b = r.open<dataset, MODE>(FILENAME);
+  REQUIRE(a != nullptr);
+  CHECK(a == b);
+  CHECK(a->version_ == 1U);
+  CHECK(a->values_.size() == 100U);
+  CHECK(r.size() == 1U);
+
+  // Different type or mode: separate mapping (the file does not match).
+  CHECK_THROWS(r.open<other_dataset, MODE>(FILENAME));
+  auto const c = r.open<dataset, MODE | cista::mode::UNCHECKED>(FILENAME);
+  CHECK(c != a);
+  CHECK(c->version_ == 1U);
+  CHECK(r.size() == 2U);
+
+  // Replaced file: new mapping, old handles stay valid.
+  write(FILENAME, 2U);
+  auto const d = r.open<dataset, MODE>(FILENAME);
+  CHECK(d != a);
+  CHECK(d->version_ == 2U);
+  CHECK(a->version_ == 1U);
+  CHECK(a->values_[99U] == 1U);
+  CHECK(r.size() == 3U);
+
+  a.reset();
+  CHECK(r.size() == 3U);
+  b.reset();
+  CHECK(r.size() == 2U);
+
+  std::remove(FILENAME);
+}
+
+TEST_CASE("mapping registry does not cache failures") {
+  constexpr auto const FILENAME = "mapping_registry_invalid.bin";
+  {
+    auto f = cista::file{FILENAME, "w+"};
+    f.write("invalid", 7U, 0U);
+  }
+
+  auto r = cista::mapping_registry{};
+  CHECK_THROWS(r.open<dataset, MODE>(FILENAME));
+  CHECK_THROWS(r.open<dataset, MODE>(FILENAME));
+  CHECK(r.size() == 0U);
+
+  write(FILENAME, 3U);
+  CHECK(r.open<dataset, MODE>(FILENAME)->version_ == 3U);
+  std::remove(FILENAME);
+}
+
+TEST_CASE("mapping registry concurrent open") {
+  constexpr auto const FILENAME = "mapping_registry_concurrent.bin";
+  write(FILENAME, 4U);
+
+  auto r = cista::mapping_registry{};
+  auto handles = std::vector<std::shared_ptr<dataset const>>(8U);
+  auto threads = std::vector<std::thread>{};
+  for (auto i = 0U; i != handles.size(); ++i) {
+    threads.emplace_back(
+        [&, i]() { handles[i] = r.open<dataset, MODE>(FILENAME); });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  for (auto const& h : handles) {
+    CHECK(h == handles.front());
+  }
+  CHECK(handles.front()->version_ == 4U);
+  CHECK(r.size() == 1U);
+
+  handles.clear();
+  CHECK(r.size() == 0U);
+  std::remove(FILENAME);
+}
+
+#endif
@@ -0,0 +1,149 @@
+#include "doctest.h"
+
+#ifdef SINGLE_HEADER
+#include "cista.h"
+#else
+#include "cista/advise.h"
+#include "cista/mmap.h"
+#include "cista/serialization.h"
+#endif
+
+namespace mmap_test {
+
+namespace data = cista::offset;
+
+// Ends in the middle of a page: sync_range() rounds the start down to a
+// page boundary and has to stay within the mapping.
+struct dataset {
+  std::uint32_t id_{0U};
+  data::vector<std::uint64_t> values_;
+};
+
+struct lookup_index {
+  data::hash_map<std::uint64_t, std::uint64_t> lookup_;
+  data::vector<std::uint64_t> values_;
+};
+
+cista::byte_buf read_file(char const* path) {
+  auto b = cista::file{path, "r"}.content();
+  return cista::byte_buf{b.data(), b.data() + b.size()};
+}
+
+}  // namespace mmap_test
+
+using namespace mmap_test;
+
+TEST_CASE("mmap grows and keeps content") {
+  constexpr auto const FILENAME = "mmap_grow.bin";
+
+  auto expected = std::vector<std::uint8_t>{};
+  {
+    auto m = cista::mmap{FILENAME};
+    for (auto i = std::size_t{0U}; i != 300'000U; ++i) {
+      auto const v = static_cast<std::uint8_t>(i * 7U);
+      m.resize(i + 1U);
+      m[i] = v;
+      expected.emplace_back(v);
+    }
+    CHECK(m.size() == expected.size());
+    CHECK(std::equal(m.begin(), m.end(), begin(expected)));
+  }
+  CHECK(read_file(FILENAME) == expected);
+}
+
+TEST_CASE("mmap durability none and sync range") {
+  constexpr auto const FILENAME = "mmap_no_sync.bin";
+
+  auto d = dataset{};
+  d.id_ = 5U;
+  for (auto i = 0U; i != 100'001U; ++i) {
+    d.values_.emplace_back(i);
+  }
+
+  {
+    auto m = cista::buf<cista::mmap>{
+        cista::mmap{FILENAME, cista::mmap::protection::WRITE,
+                    cista::mmap::durability::NONE}};
+    cista::serialize(m, d);
+    m.buf_.sync_range(0U, m.size(), true);
+    m.buf_.sync_range(m.size() / 2U, 100U);
+    m.buf_.sync_range(m.size() - 3U, 3U);
+    CHECK_THROWS(
+        m.buf_.sync_range(1U, std::numeric_limits<std::size_t>::max()));
+  }
+
+  auto b = read_file(FILENAME);
+  CHECK(b == cista::serialize(d));
+  auto const e = cista::deserialize<dataset>(b);
+  CHECK(e->id_ == 5U);
+  CHECK(e->values_[100'000U] == 100'000U);
+}
+
+TEST_CASE("mmap read-only access hints") {
+  constexpr auto const FILENAME = "mmap_hints.bin";
+
+  {
+    auto idx = lookup_index{};
+    for (auto i = 0U; i != 50'000U; ++i) {
+      idx.lookup_.emplace(i, i * 2U);
+      idx.values_.emplace_back(i);
+    }
+    auto m = cista::buf<cista::mmap>{cista::mmap{FILENAME}};
+    cista::serialize(m, idx);
+  }
+
+  for (auto const p :
+       {cista::mmap::prefault::NONE, cista::mmap::prefault::POPULATE}) {
+    auto m = cista::mmap{FILENAME, cista::advice::RANDOM, p};
+    auto const e = cista::deserialize<lookup_index>(m);
+    CHECK(e->lookup_.at(49'999U) == 99'998U);
+
+#ifndef _WIN32
+    CHECK(m.advise(cista::advice::SEQUENTIAL));
+    CHECK(m.advise(m.size() / 2U, 100U, cista::advice::WILLNEED));
+    CHECK(cista::advise(e->values_, cista::advice::WILLNEED));
+    CHECK(cista::advise(e->lookup_, cista::advice::WILLNEED));
+#endif
+    CHECK_THROWS(m.advise(m.size(), 1U, cista::advice::WILLNEED));
+    CHECK(e->values_[49'999U] == 49'999U);
+  }
+}
+
+TEST_CASE("mmap private mapping leaves the file untouched") {
+  constexpr auto const FILENAME = "mmap_private.bin";
+  namespace raw = cista::raw;
+
+  // Every pointer is fixed up, in every page of the values.
+  struct raw_dataset {
+    raw::vector<raw::unique_ptr<std::uint64_t>> values_;
+    raw::unique_ptr<std::uint64_t> value_;
+  };
+
+  {
+    auto d = raw_dataset{};
+    for (auto i = 0U; i != 1'000U; ++i) {
+      d.values_.emplace_back(raw::make_unique<std::uint64_t>(i));
+    }
+    d.value_ = raw::make_unique<std::uint64_t>(42U);
+    auto m = cista::buf<cista::mmap>{cista::mmap{FILENAME}};
+    cista::serialize(m, d);
+  }
+  auto const before = read_file(FILENAME);
+
+  {
+    auto a = cista::mmap{FILENAME, cista::mmap::protection::PRIVATE};
+    auto b = cista::mmap{FILENAME, cista::mmap::protection::PRIVATE,
+                         cista::mmap::durability::NONE, cista::advice::NORMAL,
+                         cista::mmap::prefault::POPULATE};
+    auto const da = cista::deserialize<raw_dataset>(a);
+    auto const db = cista::deserialize<raw_dataset>(b);
+    CHECK(*da->values_[999U] == 999U);
+    CHECK(*db->value_ == 42U);
+
+    *da->value_ = 7U;
+    CHECK(*db->value_ == 42U);
+    CHECK_THROWS(a.resize(a.size() + 1U));
+  }
+
+  CHECK(read_file(FILENAME) == before);
+}
@@ -0,0 +1,194 @@
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "doctest.h"
+
+#ifdef SINGLE_HEADER
+#include "cista.h"
+#else
+#include "cista/containers/hash_map.h"
+#include "cista/containers/hash_set.h"
+#include "cista/containers/parallel_insert.h"
+#include "cista/containers/string.h"
+#include "cista/serialization.h"
+#endif
+
+namespace parallel_insert_test {
+
+namespace data = cista::raw;
+
+using id_map = data::hash_map<std::uint64_t, std::uint32_t>;
+using string_map = data::hash_map<data::string, int>;
+using int_set = data::hash_set<int>;
+
+template <typename H>
+bool same_layout(H const& a, H const& b) {
+  if (a.size() != b.size() || a.capacity() != b.capacity()) {
+    return false;
+  }
+  if (std::memcmp(a.ctrl_, b.ctrl_, a.capacity() + 1U + H::WIDTH) != 0) {
+    return false;
+  }
+  for (auto s = 0U; s != a.capacity(); ++s) {
+    if (H::is_full(a.ctrl_[s]) && !(a.entries_[s] == b.entries_[s])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<id_map::entry_t> id_entries(std::size_t const n,
+                                        std::uint64_t const seed = 7U) {
+  auto rng = std::mt19937_64{seed};
+  auto entries = std::vector<id_map::entry_t>{};
+  for (auto i = std::size_t{0U}; i != n; ++i) {
+    entries.push_back({rng() % (n * 2U), static_cast<std::uint32_t>(i)});
+  }
+  return entries;  // ~20% duplicate keys
+}
+
+// Same content as insert(): all keys, value of the first occurrence.
+template <typename H, typename Entries>
+bool same_content(H const& a, Entries const& entries) {
+  auto expected = H{};
+  expected.insert(begin(entries), end(entries));
+  if (a.size() != expected.size()) {
+    return false;
+  }
+  for (auto const& e : expected) {
+    auto const it = a.find(e.first);
+    if (it == a.end() || !(it->second == e.second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void check_id_map() {
+  auto const entries = id_entries(300'000U);
+
+  auto reference = id_map{};
+  cista::parallel_insert(reference, begin(entries), end(entries), 1U);
+  CHECK(same_content(reference, entries));
+
+  for (auto const num_threads : {2U, 3U, 8U}) {
+    auto parallel = id_map{};
+    cista::parallel_insert(parallel, begin(entries), end(entries),
+                           num_threads);
+    CHECK(same_layout(reference, parallel));
+  }
+}
+
+void check_prefilled_with_erased() {
+  auto const entries = id_entries(50'000U);
+  auto const more = id_entries(70'000U, 8U);
+
+  auto sequential = id_map{};
+  auto parallel = id_map{};
+  for (auto* h : {&sequential, &parallel}) {
+    h->insert(begin(entries), end(entries));
+    for (auto i = 0U; i < entries.size(); i += 3U) {
+      h->erase(entries[i].first);
+    }
+  }
+
+  sequential.insert(begin(more), end(more));
+  cista::parallel_insert(parallel, begin(more), end(more), 3U);
+  CHECK(sequential.size() == parallel.size());
+  for (auto const& [k, v] : sequential) {
+    auto const it = parallel.find(k);
+    CHECK((it != parallel.end() && it->second == v));
+  }
+}
+
+void check_string_map() {
+  auto entries = std::vector<string_map::entry_t>{};
+  for (auto i = 0; i != 10'000; ++i) {
+    auto const k = "long key, not stored inline " + std::to_string(i % 7000);
+    entries.push_back({data::string{k}, i});
+  }
+
+  auto a = string_map{};
+  cista::parallel_insert(a, begin(entries), end(entries), 1U);
+  auto b = string_map{};
+  cista::parallel_insert(b, begin(entries), end(entries), 4U);
+
+  CHECK(same_layout(a, b));
+  CHECK(same_content(a, entries));
+  CHECK(a.size() == 7000U);
+  CHECK(a.at(std::string_view{"long key, not stored inline 42"}) == 42);
+}
+
+void check_set() {
+  auto values = std::vector<int>{};
+  for (auto i = 0; i != 100'000; ++i) {
+    values.push_back((i * 7919) % 65'536);
+  }
+
+  auto a = int_set{};
+  cista::parallel_insert(a, begin(values), end(values), 1U);
+  auto b = int_set{};
+  cista::parallel_insert(b, begin(values), end(values), 2U);
+
+  CHECK(same_layout(a, b));
+  CHECK(a.size() == 65'536U);
+  for (auto const v : values) {
+    CHECK(a.find(v) != a.end());
+  }
+}
+
+bool throw_on_copy = false;
+
+struct throwing {
+  throwing(int const v) : v_{v} {}
+  throwing(throwing const& o) : v_{o.v_} {
+    if (throw_on_copy && v_ == 77'777) {
+      throw std::runtime_error{"copy"};
+    }
+  }
+  int v_;
+};
+
+void check_exception() {
+  using map_t = data::hash_map<int, throwing>;
+  auto entries = std::vector<map_t::entry_t>{};
+  for (auto i = 0; i != 100'000; ++i) {
+    entries.push_back({i, throwing{i}});
+  }
+
+  auto m = map_t{};
+  throw_on_copy = true;
+  CHECK_THROWS(cista::parallel_insert(m, begin(entries), end(entries), 4U));
+  throw_on_copy = false;
+
+  auto n = std::size_t{0U};
+  for (auto const& [k, v] : m) {
+    CHECK(k == v.v_);
+    CHECK(m.find(k) != m.end());
+    ++n;
+  }
+  CHECK(n == m.size());
+  CHECK(m.size() < entries.size());
+  CHECK(m.find(77'777) == m.end());
+}
+
+}  // namespace parallel_insert_test
+
+using namespace parallel_insert_test;
+
+TEST_CASE("parallel insert layout independent of thread count") {
+  check_id_map();
+}
+
+TEST_CASE("parallel insert into map with erased entries") {
+  check_prefilled_with_erased();
+}
+
+TEST_CASE("parallel insert string keys") { check_string_map(); }
+
+TEST_CASE("parallel insert hash set") { check_set(); }
+
+TEST_CASE("parallel insert copy exception") { check_exception(); }
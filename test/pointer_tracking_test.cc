@@ -0,0 +1,104 @@
+#include "doctest.h"
+
+#ifdef SINGLE_HEADER
+#include "cista.h"
+#else
+#include "cista/serialization.h"
+#endif
+
+namespace pointer_tracking_test {
+
+namespace data = cista::offset;
+
+struct tree {
+  std::uint32_t id_;
+  data::vector<tree> children_;
+  data::unique_ptr<tree> first_;
+};
+
+struct plain {
+  data::vector<data::string> strings_;
+  data::hash_map<data::string, data::vector<std::uint64_t>> map_;
+  data::array<cista::optional<double>, 4U> values_;
+  data::variant<int, data::string> variant_;
+  tree tree_;
+};
+
+struct with_ptr {
+  data::vector<int> values_;
+  data::ptr<int> best_;
+};
+
+struct nested_ptr {
+  data::hash_map<int, data::vector<with_ptr>> map_;
+};
+
+struct bit_fields {
+  std::uint32_t a_ : 16;
+  std::uint32_t b_ : 16;
+};
+
+template <typename Ctx>
+void serialize(Ctx&, bit_fields const*, cista::offset_t const) {}
+
+template <typename Ctx>
+void deserialize(Ctx const&, bit_fields*) {}
+
+union ptr_union {
+  std::uint32_t id_;
+  data::ptr<std::uint32_t> ptr_;
+};
+
+template <typename Ctx>
+void serialize(Ctx&, ptr_union const*, cista::offset_t const) {}
+
+template <typename Ctx>
+void deserialize(Ctx const&, ptr_union*) {}
+
+union plain_union {
+  std::uint32_t a_;
+  float b_;
+};
+
+}  // namespace pointer_tracking_test
+
+using namespace pointer_tracking_test;
+
+TEST_CASE("has_non_owning_ptr") {
+  CHECK(!cista::has_non_owning_ptr_v<data::vector<int>>);
+  CHECK(!cista::has_non_owning_ptr_v<tree>);
+  CHECK(!cista::has_non_owning_ptr_v<plain>);
+  CHECK(cista::has_non_owning_ptr_v<data::ptr<int>>);
+  CHECK(cista::has_non_owning_ptr_v<with_ptr>);
+  CHECK(cista::has_non_owning_ptr_v<nested_ptr>);
+  CHECK(cista::has_non_owning_ptr_v<cista::raw::vector<cista::raw::ptr<int>>>);
+  CHECK(cista::has_non_owning_ptr_v<bit_fields>);
+  CHECK(cista::has_non_owning_ptr_v<ptr_union>);
+  CHECK(cista::has_non_owning_ptr_v<data::vector<ptr_union>>);
+  CHECK(!cista::has_non_owning_ptr_v<plain_union>);
+}
+
+TEST_CASE("serialize pointer-free type graph") {
+  auto p = plain{};
+  p.strings_ = {data::string{"a"},
+                data::string{"long enough to be on the heap"}};
+  p.map_["key"] = {1U, 2U, 3U};
+  p.values_[1] = 3.0;
+  p.variant_ = data::string{"variant string that is long"};
+  p.tree_.id_ = 1U;
+  p.tree_.children_.emplace_back(tree{2U, {}, nullptr});
+  p.tree_.first_ = data::make_unique<tree>(tree{3U, {}, nullptr});
+
+  auto const buf = cista::serialize(p);
+  auto const d = cista::deserialize<plain>(buf);
+  CHECK(d->strings_.size() == 2U);
+  CHECK(d->strings_[1] == "long enough to be on the heap");
+  CHECK(d->map_.at(data::string{"key"}) ==
+        data::vector<std::uint64_t>{1U, 2U, 3U});
+  CHECK(!d->values_[0].has_value());
+  CHECK(d->values_[1].value() == 3.0);
+  CHECK(cista::get<data::string>(d->variant_) ==
+        "variant string that is long");
+  CHECK(d->tree_.children_.at(0).id_ == 2U);
+  CHECK(d->tree_.first_->id_ == 3U);
+}
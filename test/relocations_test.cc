@@ -0,0 +1,164 @@
+#include "doctest.h"
+
+#ifdef SINGLE_HEADER
+#include "cista.h"
+#else
+#include "cista/serialization.h"
+#endif
+
+namespace relocations_test {
+
+namespace data = cista::raw;
+
+struct node {
+  std::uint32_t id_{0U};
+  data::string name_;
+  data::vector<data::ptr<node>> neighbors_;
+  data::ptr<node> parent_{nullptr};
+};
+
+struct graph {
+  data::vector<data::unique_ptr<node>> nodes_;
+  data::hash_map<data::string, data::vector<std::uint32_t>> index_;
+  data::hash_map<int, int> empty_map_;
+  data::vector<int> empty_vector_;
+  data::ptr<node> root_{nullptr};
+};
+
+graph make_graph() {
+  auto g = graph{};
+  for (auto i = 0U; i != 100U; ++i) {
+    g.nodes_.emplace_back(data::make_unique<node>(
+        node{i, data::string{"node name that is not short"}, {}, nullptr}));
+  }
+  for (auto i = 1U; i != 100U; ++i) {
+    g.nodes_[i]->parent_ = g.nodes_[i - 1U].get();
+    g.nodes_[i - 1U]->neighbors_.emplace_back(g.nodes_[i].get());
+    g.nodes_[i - 1U]->neighbors_.emplace_back(g.nodes_[(i * 7U) % 100U].get());
+  }
+  g.index_[data::string{"a"}] = {1U, 2U};
+  g.index_[data::string{"a key long enough to be on the heap"}] = {3U};
+  g.root_ = g.nodes_[42U].get();
+  return g;
+}
+
+void check_graph(graph const* g) {
+  REQUIRE(g->nodes_.size() == 100U);
+  CHECK(g->root_ == g->nodes_[42U].get());
+  CHECK(g->nodes_[0U]->parent_ == nullptr);
+  for (auto i = 1U; i != 100U; ++i) {
+    CHECK(g->nodes_[i]->id_ == i);
+    CHECK(g->nodes_[i]->parent_ == g->nodes_[i - 1U].get());
+    CHECK(g->nodes_[i]->name_ == "node name that is not short");
+    CHECK(g->nodes_[i - 1U]->neighbors_.at(1U) ==
+          g->nodes_[(i * 7U) % 100U].get());
+  }
+  CHECK(g->index_.at(data::string{"a"}).size() == 2U);
+  CHECK(g->index_.at(data::string{"a key long enough to be on the heap"})
+            .at(0U) == 3U);
+  CHECK(g->empty_map_.find(1) == g->empty_map_.end());
+  CHECK(g->empty_vector_.empty());
+}
+
+}  // namespace relocations_test
+
+using namespace relocations_test;
+
+TEST_CASE("relocations round trip") {
+  constexpr auto const MODE = cista::mode::WITH_RELOCATIONS;
+
+  auto g = make_graph();
+  auto buf = cista::serialize<MODE>(g);
+  CHECK(buf.size() == cista::serialized_size_of<MODE>(g));
+  check_graph(cista::deserialize<graph, MODE>(buf));
+}
+
+TEST_CASE("relocations with version, integrity and deep check") {
+  constexpr auto const MODE = cista::mode::WITH_RELOCATIONS |
+                              cista::mode::WITH_VERSION |
+                              cista::mode::WITH_INTEGRITY;
+
+  auto g = make_graph();
+  auto buf = cista::serialize<MODE>(g);
+  CHECK(buf.size() == cista::serialized_size_of<MODE>(g));
+
+  auto copy = buf;
+  check_graph(cista::deserialize<graph, MODE | cista::mode::DEEP_CHECK>(copy));
+
+  buf[buf.size() / 2U] ^= 0xFFU;
+  CHECK_THROWS(cista::deserialize<graph, MODE>(buf));
+}
+
+TEST_CASE("relocations only append to the serialized data") {
+  auto g = make_graph();
+  auto plain = cista::serialize(g);
+  auto relocatable = cista::serialize<cista::mode::WITH_RELOCATIONS>(g);
+  REQUIRE(relocatable.size() > plain.size());
+  CHECK(std::equal(begin(plain), end(plain), begin(relocatable)));
+
+  check_graph(cista::deserialize<graph>(plain));
+  check_graph(
+      cista::deserialize<graph, cista::mode::WITH_RELOCATIONS>(relocatable));
+}
+
+TEST_CASE("relocations bounds check") {
+  constexpr auto const MODE = cista::mode::WITH_RELOCATIONS;
+
+  auto g = make_graph();
+  auto buf = cista::serialize<MODE>(g);
+
+  SUBCASE("corrupt table size") {
+    buf[buf.size() - sizeof(std::uint64_t) + 7U] = 0x7FU;
+    CHECK_THROWS(cista::deserialize<graph, MODE>(buf));
+  }
+
+  SUBCASE("corrupt pointer") {
+    auto const root_offset = reinterpret_cast<std::uint8_t const*>(&g.root_) -
+                             reinterpret_cast<std::uint8_t const*>(&g);
+    auto const garbage = std::numeric_limits<cista::offset_t>::max() / 2;
+    std::memcpy(&buf[static_cast<std::size_t>(root_offset)], &garbage,
+                sizeof(garbage));
+    CHECK_THROWS(cista::deserialize<graph, MODE>(buf));
+  }
+
+  auto const offset_of = [&](auto const& member) {
+    return static_cast<std::size_t>(
+        reinterpret_cast<std::uint8_t const*>(&member) -
+        reinterpret_cast<std::uint8_t const*>(&g));
+  };
+
+  SUBCASE("misaligned pointer target") {
+    auto offset = cista::offset_t{};
+    std::memcpy(&offset, &buf[offset_of(g.root_)], sizeof(offset));
+    ++offset;
+    std::memcpy(&buf[offset_of(g.root_)], &offset, sizeof(offset));
+    CHECK_THROWS(cista::deserialize<graph, MODE>(buf));
+  }
+
+  SUBCASE("corrupt vector size") {
+    auto const huge = decltype(g.nodes_.used_size_){1'000'000'000U};
+    std::memcpy(&buf[offset_of(g.nodes_.used_size_)], &huge, sizeof(huge));
+    std::memcpy(&buf[offset_of(g.nodes_.allocated_size_)], &huge,
+                sizeof(huge));
+    CHECK_THROWS(cista::deserialize<graph, MODE>(buf));
+  }
+}
+
+TEST_CASE("relocations without raw pointers are still checked") {
+  constexpr auto const MODE = cista::mode::WITH_RELOCATIONS;
+  using vec_t = cista::offset::vector<std::uint32_t>;
+
+  auto v = vec_t{1U, 2U, 3U};
+  auto buf = cista::serialize<MODE>(v);
+  CHECK(cista::deserialize<vec_t, MODE>(buf)->size() == 3U);
+
+  auto const offset_of = [&](auto const& member) {
+    return static_cast<std::size_t>(
+        reinterpret_cast<std::uint8_t const*>(&member) -
+        reinterpret_cast<std::uint8_t const*>(&v));
+  };
+  auto const huge = vec_t::size_type{1'000'000'000U};
+  std::memcpy(&buf[offset_of(v.used_size_)], &huge, sizeof(huge));
+  std::memcpy(&buf[offset_of(v.allocated_size_)], &huge, sizeof(huge));
+  CHECK_THROWS(cista::deserialize<vec_t, MODE>(buf));
+}
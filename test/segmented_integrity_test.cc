@@ -0,0 +1,164 @@
+#include "doctest.h"
+
+#ifdef SINGLE_HEADER
+#include "cista.h"
+#else
+#include "cista/serialization.h"
+#endif
+
+namespace segmented_integrity_test {
+
+namespace data = cista::offset;
+
+// The pointers precede their targets: they are fixed up after the segment
+// holding them was hashed while writing (see segment_tracker). The values
+// end in the middle of a segment.
+struct dataset {
+  std::uint32_t id_{0U};
+  data::vector<data::ptr<std::uint64_t>> segment_starts_;
+  data::indexed_vector<std::uint64_t> values_;
+};
+
+constexpr auto const VALUES_PER_SEGMENT =
+    cista::SEGMENT_SIZE / sizeof(std::uint64_t);
+constexpr auto const NUM_VALUES = 9U * VALUES_PER_SEGMENT / 2U;
+
+dataset make_dataset() {
+  auto d = dataset{};
+  d.id_ = 42U;
+  for (auto i = 0U; i != NUM_VALUES; ++i) {
+    d.values_.emplace_back(i * 7U);
+  }
+  for (auto i = 0U; i < NUM_VALUES; i += VALUES_PER_SEGMENT) {
+    d.segment_starts_.emplace_back(&d.values_[i]);
+  }
+  return d;
+}
+
+constexpr auto const MODE =
+    cista::mode::WITH_VERSION | cista::mode::WITH_SEGMENTED_INTEGRITY;
+
+}  // namespace segmented_integrity_test
+
+using namespace segmented_integrity_test;
+
+TEST_CASE("segmented integrity round trip") {
+  auto d = make_dataset();
+  auto buf = cista::serialize<MODE>(d);
+  CHECK(buf.size() > 4U * cista::SEGMENT_SIZE);
+
+  auto const payload = std::string_view{
+      reinterpret_cast<char const*>(buf.data() + cista::data_start(MODE)),
+      buf.size() - cista::data_start(MODE)};
+  auto stored = cista::hash_t{};
+  std::memcpy(&stored, buf.data() + cista::integrity_start(MODE),
+              sizeof(stored));
+  CHECK(stored == cista::segmented_hash(payload, 1U));
+  CHECK(stored == cista::segmented_hash(payload, 4U));
+  CHECK(stored != cista::hash(payload));
+
+  auto const e = cista::deserialize<dataset, MODE>(buf);
+  CHECK(e->id_ == 42U);
+  REQUIRE(e->values_.size() == NUM_VALUES);
+  CHECK(e->values_[NUM_VALUES - 1U] == (NUM_VALUES - 1U) * 7U);
+  REQUIRE(e->segment_starts_.size() == 5U);
+  for (auto i = 0U; i != e->segment_starts_.size(); ++i) {
+    CHECK(e->segment_starts_[i] == &e->values_[i * VALUES_PER_SEGMENT]);
+  }
+}
+
+TEST_CASE("segmented integrity detects corruption") {
+  auto const d = make_dataset();
+  auto const original = cista::serialize<MODE>(d);
+
+  auto copy = original;
+  auto const pointer_pos = static_cast<std::size_t>(
+      reinterpret_cast<std::uint8_t const*>(
+          &cista::deserialize<dataset, MODE>(copy)->segment_starts_[1U]) -
+      copy.data());
+
+  // Last byte of a segment, first byte of the next one, a fixed-up pointer.
+  auto const segment_end = cista::data_start(MODE) + 2U * cista::SEGMENT_SIZE;
+  for (auto const pos : {segment_end - 1U, segment_end, pointer_pos}) {
+    auto buf = original;
+    buf[pos] ^= 0x01U;
+    CHECK_THROWS(cista::deserialize<dataset, MODE>(buf));
+  }
+
+  auto buf = original;
+  buf[segment_end] ^= 0x01U;
+  CHECK_NOTHROW(cista::deserialize<dataset, cista::mode::WITH_VERSION |
+                                                cista::mode::SKIP_INTEGRITY>(
+      buf));
+}
+
+TEST_CASE("segmented integrity small and empty payload") {
+  auto const empty = cista::segmented_hash(std::string_view{}, 4U);
+  CHECK(empty == cista::combine_segment_hashes({}));
+
+  auto v = data::vector<int>{1, 2, 3};
+  auto buf = cista::serialize<cista::mode::WITH_SEGMENTED_INTEGRITY>(v);
+  auto const e =
+      cista::deserialize<data::vector<int>,
+                         cista::mode::WITH_SEGMENTED_INTEGRITY>(buf);
+  CHECK(*e == data::vector<int>{1, 2, 3});
+}
+
+TEST_CASE("segmented integrity file target") {
+  constexpr auto const FILENAME = "segmented_integrity.bin";
+
+  auto d = make_dataset();
+  {
+    cista::file f{FILENAME, "w+"};
+    cista::serialize<MODE>(f, d);
+  }
+
+  auto b = cista::file(FILENAME, "r").content();
+  auto const e = cista::deserialize<dataset, MODE>(b);
+  CHECK(e->values_.size() == NUM_VALUES);
+  CHECK(cista::serialize<MODE>(d) ==
+        cista::byte_buf{b.data(), b.data() + b.size()});
+}
+
+TEST_CASE("segment hashes tracked while writing") {
+  constexpr auto const FILENAME = "segment_tracking.bin";
+  constexpr auto const START = cista::offset_t{16};
+
+  auto bytes = std::vector<std::uint8_t>(3U * cista::SEGMENT_SIZE + 100U);
+  for (auto i = std::size_t{0U}; i != bytes.size(); ++i) {
+    bytes[i] = static_cast<std::uint8_t>(i * 13U);
+  }
+  auto const patch = std::uint64_t{0xDEADBEEFDEADBEEF};
+  auto const patch_positions = std::vector<std::size_t>{
+      START + cista::SEGMENT_SIZE - 4U,  // across a segment boundary
+      START + 2U * cista::SEGMENT_SIZE + 8U, START + 3U * cista::SEGMENT_SIZE};
+
+  auto const write = [&](auto& t) {
+    auto const header = std::array<std::uint8_t, START>{};
+    t.write(header.data(), header.size(), 0U);
+    t.track_segments(START);
+    for (auto i = std::size_t{0U}; i < bytes.size(); i += 1000U) {
+      t.write(&bytes[i], std::min(std::size_t{1000U}, bytes.size() - i), 0U);
+    }
+    for (auto const pos : patch_positions) {
+      t.write(pos, patch);
+    }
+  };
+
+  auto expected = bytes;
+  for (auto const pos : patch_positions) {
+    std::memcpy(&expected[pos - START], &patch, sizeof(patch));
+  }
+  auto const expected_hashes = cista::segment_hashes(std::string_view{
+      reinterpret_cast<char const*>(expected.data()), expected.size()});
+
+  auto b = cista::buf{};
+  write(b);
+  CHECK(b.segment_hashes(START) == expected_hashes);
+
+  {
+    cista::file f{FILENAME, "w+"};
+    write(f);
+    CHECK(f.segment_hashes(START) == expected_hashes);
+  }
+}
@@ -0,0 +1,156 @@
+#include "doctest.h"
+
+#ifdef SINGLE_HEADER
+#include "cista.h"
+#else
+#include "cista/serialize_parallel.h"
+#endif
+
+namespace serialize_parallel_test {
+
+namespace data = cista::offset;
+
+struct node {
+  std::uint32_t id_{0U};
+  data::string name_;
+};
+
+struct root {
+  std::uint64_t version_{0U};
+  data::indexed_vector<node> nodes_;
+  data::vector<data::ptr<node>> favorites_;
+  data::vecvec<std::uint32_t, std::uint32_t> neighbors_;
+  data::hash_map<data::string, data::vector<std::uint32_t>> index_;
+  data::vector<double> weights_;
+  data::ptr<node> best_{nullptr};
+};
+
+root make_root() {
+  auto r = root{};
+  r.version_ = 42U;
+  for (auto i = 0U; i != 1000U; ++i) {
+    r.nodes_.emplace_back(node{i, data::string{"node name on the heap"}});
+    r.neighbors_.emplace_back(
+        std::initializer_list<std::uint32_t>{i, (i * 7U) % 1000U});
+    r.weights_.emplace_back(i / 10.0);
+  }
+  for (auto i = 0U; i != 1000U; i += 10U) {
+    r.favorites_.emplace_back(&r.nodes_[i]);
+  }
+  r.index_[data::string{"short"}] = {1U, 2U};
+  r.index_[data::string{"a key long enough to be on the heap"}] = {3U};
+  r.best_ = &r.nodes_[999U];
+  return r;
+}
+
+void check_root(root const* r) {
+  CHECK(r->version_ == 42U);
+  REQUIRE(r->nodes_.size() == 1000U);
+  REQUIRE(r->favorites_.size() == 100U);
+  for (auto i = 0U; i != 1000U; ++i) {
+    CHECK(r->nodes_[i].id_ == i);
+    CHECK(r->nodes_[i].name_ == "node name on the heap");
+    CHECK(r->neighbors_[i][1] == (i * 7U) % 1000U);
+    CHECK(r->weights_[i] == i / 10.0);
+  }
+  for (auto i = 0U; i != 100U; ++i) {
+    CHECK(r->favorites_[i] == &r->nodes_[i * 10U]);
+  }
+  CHECK(r->index_.at(data::string{"short"}).size() == 2U);
+  CHECK(r->best_ == &r->nodes_[999U]);
+}
+
+}  // namespace serialize_parallel_test
+
+using namespace serialize_parallel_test;
+
+TEST_CASE("serialize_parallel round trip") {
+  auto r = make_root();
+
+  auto b = cista::buf{};
+  cista::serialize_parallel(b, r, 4U);
+  check_root(cista::deserialize<root>(b.buf_));
+}
+
+TEST_CASE("serialize_parallel output independent of thread count") {
+  constexpr auto const MODE =
+      cista::mode::WITH_VERSION | cista::mode::WITH_INTEGRITY;
+
+  auto r = make_root();
+
+  auto single = cista::buf{};
+  cista::serialize_parallel<MODE>(single, r, 1U);
+
+  auto multi = cista::buf{};
+  cista::serialize_parallel<MODE>(multi, r, 8U);
+
+  CHECK(single.buf_ == multi.buf_);
+  check_root(cista::deserialize<root, MODE>(multi.buf_));
+}
+
+TEST_CASE("serialize_parallel raw relocations") {
+  namespace raw = cista::raw;
+
+  struct raw_root {
+    raw::vector<raw::unique_ptr<int>> values_;
+    raw::vector<raw::ptr<int>> refs_;
+    raw::string name_;
+  };
+
+  auto r = raw_root{};
+  for (auto i = 0; i != 100; ++i) {
+    r.values_.emplace_back(raw::make_unique<int>(i));
+  }
+  for (auto i = 0U; i != 100U; i += 2U) {
+    r.refs_.emplace_back(r.values_[i].get());
+  }
+  r.name_ = raw::string{"a raw string that is long"};
+
+  constexpr auto const MODE = cista::mode::WITH_RELOCATIONS;
+  auto b = cista::buf{};
+  cista::serialize_parallel<MODE>(b, r, 3U);
+
+  auto const d = cista::deserialize<raw_root, MODE>(b.buf_);
+  REQUIRE(d->refs_.size() == 50U);
+  for (auto i = 0U; i != 50U; ++i) {
+    CHECK(d->refs_[i] == d->values_[i * 2U].get());
+    CHECK(*d->refs_[i] == static_cast<int>(i * 2U));
+  }
+  CHECK(d->name_ == "a raw string that is long");
+}
+
+TEST_CASE("serialize_parallel segment hashes") {
+  struct big_root {
+    data::indexed_vector<std::uint64_t> values_;
+    data::vector<data::ptr<std::uint64_t>> refs_;
+    data::vector<std::uint32_t> small_;
+  };
+
+  // Regions span several segments, references between regions are resolved
+  // after the workers hashed their segments.
+  auto r = big_root{};
+  for (auto i = 0U; i != 100'000U; ++i) {
+    r.values_.emplace_back(i);
+  }
+  for (auto i = 0U; i < 100'000U; i += 7U) {
+    r.refs_.emplace_back(&r.values_[i]);
+  }
+  r.small_ = {1U, 2U, 3U};
+
+  auto const check = [&](auto const mode_constant) {
+    constexpr auto const MODE = decltype(mode_constant)::value;
+    auto parallel = cista::buf{};
+    cista::serialize_parallel<MODE>(parallel, r, 3U);
+
+    auto const d = cista::deserialize<big_root, MODE>(parallel.buf_);
+    REQUIRE(d->refs_.size() == r.refs_.size());
+    for (auto i = 0U; i != d->refs_.size(); ++i) {
+      CHECK(d->refs_[i] == &d->values_[i * 7U]);
+    }
+    CHECK(d->small_.size() == 3U);
+  };
+  check(std::integral_constant<cista::mode,
+                               cista::mode::WITH_SEGMENTED_INTEGRITY>{});
+  check(std::integral_constant<cista::mode,
+                               cista::mode::WITH_BLOCK_INTEGRITY>{});
+}
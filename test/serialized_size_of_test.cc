@@ -0,0 +1,73 @@
+#include "doctest.h"
+
+#ifdef SINGLE_HEADER
+#include "cista.h"
+#else
+#include "cista/serialization.h"
+#endif
+
+namespace serialized_size_of_test {
+
+namespace data = cista::offset;
+
+struct node {
+  std::uint8_t flag_{0U};
+  data::string name_;
+  data::vector<double> weights_;
+  data::ptr<node> parent_{nullptr};
+};
+
+struct root {
+  data::vector<std::uint8_t> bytes_;
+  data::indexed_vector<node> nodes_;
+  data::hash_map<data::string, data::vector<std::uint16_t>> map_;
+  data::unique_ptr<node> extra_;
+};
+
+root make_root() {
+  root r;
+  r.bytes_ = {1U, 2U, 3U};
+  for (auto i = 0U; i != 10U; ++i) {
+    r.nodes_.emplace_back(node{static_cast<std::uint8_t>(i),
+                               data::string{"a string longer than 15 chars"},
+                               data::vector<double>{1.0, 2.0, 3.0}, nullptr});
+  }
+  for (auto i = 1U; i != 10U; ++i) {
+    r.nodes_[i].parent_ = &r.nodes_[i - 1U];
+  }
+  r.map_["short"] = {1U, 2U};
+  r.map_["this is a long key for a hash map"] = {3U, 4U, 5U};
+  r.extra_ = data::make_unique<node>(node{7U, data::string{"x"}, {}, nullptr});
+  return r;
+}
+
+}  // namespace serialized_size_of_test
+
+using namespace serialized_size_of_test;
+
+TEST_CASE("serialized_size_of matches serialize") {
+  auto r = make_root();
+
+  CHECK(cista::serialized_size_of(r) == cista::serialize(r).size());
+
+  constexpr auto const MODE =
+      cista::mode::WITH_VERSION | cista::mode::WITH_INTEGRITY;
+  CHECK(cista::serialized_size_of<MODE>(r) ==
+        cista::serialize<MODE>(r).size());
+
+  constexpr auto const BIG_ENDIAN_MODE = cista::mode::SERIALIZE_BIG_ENDIAN;
+  CHECK(cista::serialized_size_of<BIG_ENDIAN_MODE>(r) ==
+        cista::serialize<BIG_ENDIAN_MODE>(r).size());
+}
+
+TEST_CASE("serialized_size_of non-empty target") {
+  auto r = make_root();
+
+  auto b = cista::buf{};
+  std::uint8_t const prefix[3U] = {0U, 1U, 2U};
+  b.write(prefix, sizeof(prefix));
+
+  auto const expected = cista::serialized_size_of(r, b.size());
+  cista::serialize(b, r);
+  CHECK(b.size() == sizeof(prefix) + expected);
+}
@@ -0,0 +1,121 @@
+#ifdef __linux__
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "doctest.h"
+
+#ifdef SINGLE_HEADER
+#include "cista.h"
+#else
+#include "cista/serialization.h"
+#include "cista/shared_memory.h"
+#endif
+
+namespace shared_memory_test {
+
+namespace data = cista::offset;
+
+// Grows the memfd through several remaps. The size is not a power of two:
+// seal() has to truncate the memfd to it.
+struct dataset {
+  data::vector<std::uint64_t> values_;
+  data::hash_map<std::uint64_t, std::uint32_t> ids_;
+};
+
+dataset make_dataset() {
+  auto d = dataset{};
+  for (auto i = 0U; i != 100'003U; ++i) {
+    d.values_.emplace_back(i * 3U);
+  }
+  for (auto i = 0U; i != 1'000U; ++i) {
+    d.ids_.emplace(i * 3U, i);
+  }
+  return d;
+}
+
+}  // namespace shared_memory_test
+
+using namespace shared_memory_test;
+
+TEST_CASE("memfd round trip") {
+  auto d = make_dataset();
+  auto out = cista::buf<cista::memfd>{cista::memfd{"shared_memory_test"}};
+  cista::serialize(out, d);
+  auto const expected = cista::serialize(d);
+  CHECK(!out.buf_.is_sealed());
+  CHECK(cista::memfd_view{out.buf_.fd()}.is_sealed() == false);
+
+  out.buf_.seal();
+  CHECK(out.buf_.is_sealed());
+  CHECK(out.buf_.size() == expected.size());
+  CHECK_THROWS(out.buf_.resize(out.buf_.size() + 1U));
+
+  auto in = cista::memfd_view{out.buf_.fd()};
+  REQUIRE(in.is_sealed());
+  CHECK(in.size() == expected.size());
+  CHECK(std::equal(in.begin(), in.end(), expected.begin()));
+
+  auto const e = cista::deserialize<dataset, cista::mode::CAST>(in);
+  CHECK(e->values_[100'002U] == 100'002U * 3U);
+  CHECK(e->ids_.at(999U * 3U) == 999U);
+
+  auto by_path = cista::memfd_view{out.buf_.path().c_str()};
+  CHECK(by_path.is_sealed());
+  CHECK(cista::deserialize<dataset>(by_path)->values_.size() == 100'003U);
+}
+
+TEST_CASE("memfd private view for raw data") {
+  namespace raw = cista::raw;
+  struct raw_dataset {
+    raw::vector<raw::unique_ptr<std::uint64_t>> values_;
+  };
+
+  auto d = raw_dataset{};
+  for (auto i = 0U; i != 100U; ++i) {
+    d.values_.emplace_back(raw::make_unique<std::uint64_t>(i));
+  }
+
+  auto out = cista::buf<cista::memfd>{cista::memfd{"shared_memory_raw"}};
+  cista::serialize(out, d);
+  out.buf_.seal();
+  auto const sealed = std::string{out.buf_.view()};
+
+  // Pointer fix-ups write to private copies of the pages only.
+  auto a = cista::memfd_view{out.buf_.fd(), cista::mmap::protection::PRIVATE};
+  auto b = cista::memfd_view{out.buf_.fd(), cista::mmap::protection::PRIVATE};
+  auto const da = cista::deserialize<raw_dataset>(a);
+  auto const db = cista::deserialize<raw_dataset>(b);
+  *da->values_[99U] = 7U;
+  CHECK(*db->values_[99U] == 99U);
+  CHECK(out.buf_.view() == sealed);
+}
+
+TEST_CASE("memfd handoff to another process") {
+  auto d = make_dataset();
+  auto out = cista::buf<cista::memfd>{cista::memfd{"shared_memory_fork"}};
+  cista::serialize(out, d);
+  out.buf_.seal();
+
+  auto const pid = ::fork();
+  REQUIRE(pid != -1);
+  if (pid == 0) {
+    auto ok = false;
+    try {
+      auto in = cista::memfd_view{out.buf_.fd()};
+      auto const e = cista::deserialize<dataset, cista::mode::CAST>(in);
+      ok = in.is_sealed() && e->values_[1'000U] == 3'000U;
+    } catch (...) {
+    }
+    ::_exit(ok ? 0 : 1);
+  }
+
+  auto status = 0;
+  REQUIRE(::waitpid(pid, &status, 0) == pid);
+  CHECK(WIFEXITED(status));
+  CHECK(WEXITSTATUS(status) == 0);
+}
+
+#endif
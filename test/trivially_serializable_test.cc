@@ -0,0 +1,164 @@
+#include "doctest.h"
+
+#ifdef SINGLE_HEADER
+#include "cista.h"
+#else
+#include "cista/serialization.h"
+#endif
+
+namespace trivially_serializable_test {
+
+namespace data = cista::offset;
+
+struct pod {
+  std::uint8_t a_;
+  std::uint32_t b_;
+  double c_;
+  data::array<std::uint16_t, 3U> d_;
+};
+
+struct with_string {
+  std::uint32_t a_;
+  data::string s_;
+};
+
+struct with_ptr {
+  std::uint32_t a_;
+  data::ptr<std::uint32_t> p_;
+};
+
+struct columns {
+  data::vector<std::uint32_t> ids_;
+  data::vector<pod> pods_;
+  data::hash_map<std::uint32_t, pod> map_;
+  data::array<pod, 2U> array_;
+};
+
+union plain_union {
+  std::uint32_t a_;
+  float b_;
+};
+
+static auto union_deserialize_calls = 0U;
+
+union checked_union {
+  std::uint32_t a_;
+  float b_;
+};
+
+template <typename Ctx>
+void deserialize(Ctx const&, checked_union*) {
+  ++union_deserialize_calls;
+}
+
+columns make_columns() {
+  auto c = columns{};
+  for (auto i = 0U; i != 1000U; ++i) {
+    c.ids_.push_back(i * 7U);
+    c.pods_.push_back(
+        pod{static_cast<std::uint8_t>(i), i, i / 2.0, {1U, 2U, 3U}});
+    c.map_[i] = pod{0U, i * 3U, 1.0, {4U, 5U, 6U}};
+  }
+  c.array_[1] = pod{1U, 2U, 3.0, {4U, 5U, 6U}};
+  return c;
+}
+
+}  // namespace trivially_serializable_test
+
+using namespace trivially_serializable_test;
+
+TEST_CASE("is_trivially_serializable") {
+  constexpr auto const LE = cista::mode::NONE;
+#if defined(CISTA_LITTLE_ENDIAN)
+  constexpr auto const NATIVE = LE;
+  constexpr auto const FOREIGN = cista::mode::SERIALIZE_BIG_ENDIAN;
+#else
+  constexpr auto const NATIVE = cista::mode::SERIALIZE_BIG_ENDIAN;
+  constexpr auto const FOREIGN = LE;
+#endif
+
+  CHECK(cista::is_trivially_serializable_v<std::uint32_t, NATIVE>);
+  CHECK(cista::is_trivially_serializable_v<pod, NATIVE>);
+  CHECK(cista::is_trivially_serializable_v<cista::pair<int, pod>, NATIVE>);
+  CHECK(cista::is_trivially_serializable_v<cista::optional<pod>, NATIVE>);
+  CHECK(!cista::is_trivially_serializable_v<std::uint32_t, FOREIGN>);
+  CHECK(!cista::is_trivially_serializable_v<pod, FOREIGN>);
+  CHECK(!cista::is_trivially_serializable_v<with_string, NATIVE>);
+  CHECK(!cista::is_trivially_serializable_v<with_ptr, NATIVE>);
+  CHECK(!cista::is_trivially_serializable_v<data::vector<int>, NATIVE>);
+  CHECK(!cista::is_trivially_serializable_v<cista::indexed<pod>, NATIVE>);
+}
+
+template <cista::mode const Mode>
+void check_columns_round_trip(columns& c) {
+  auto buf = cista::serialize<Mode>(c);
+  auto const d = cista::deserialize<columns, Mode>(buf);
+  REQUIRE(d->ids_.size() == 1000U);
+  REQUIRE(d->pods_.size() == 1000U);
+  REQUIRE(d->map_.size() == 1000U);
+  for (auto i = 0U; i != 1000U; ++i) {
+    CHECK(d->ids_[i] == i * 7U);
+    CHECK(d->pods_[i].a_ == static_cast<std::uint8_t>(i));
+    CHECK(d->pods_[i].b_ == i);
+    CHECK(d->pods_[i].d_[2] == 3U);
+    CHECK(d->map_.at(i).b_ == i * 3U);
+  }
+  CHECK(d->array_[1].d_[1] == 5U);
+}
+
+TEST_CASE("is_trivially_deserializable") {
+#if defined(CISTA_LITTLE_ENDIAN)
+  constexpr auto const NATIVE = cista::mode::NONE;
+  constexpr auto const FOREIGN = cista::mode::SERIALIZE_BIG_ENDIAN;
+#else
+  constexpr auto const NATIVE = cista::mode::SERIALIZE_BIG_ENDIAN;
+  constexpr auto const FOREIGN = cista::mode::NONE;
+#endif
+
+  CHECK(cista::is_trivially_deserializable_v<double, NATIVE>);
+  CHECK(cista::is_trivially_deserializable_v<pod, NATIVE>);
+  CHECK(cista::is_trivially_deserializable_v<cista::indexed<pod>, NATIVE>);
+  CHECK(!cista::is_trivially_deserializable_v<pod, FOREIGN>);
+  CHECK(!cista::is_trivially_deserializable_v<with_string, NATIVE>);
+  CHECK(!cista::is_trivially_deserializable_v<with_ptr, NATIVE>);
+  CHECK(!cista::is_trivially_deserializable_v<cista::optional<int>, NATIVE>);
+  CHECK(!cista::is_trivially_deserializable_v<
+        cista::variant<int, double>, NATIVE>);
+  CHECK(cista::is_trivially_deserializable_v<plain_union, NATIVE>);
+  CHECK(!cista::is_trivially_deserializable_v<checked_union, NATIVE>);
+}
+
+TEST_CASE("custom deserialize of union elements is called") {
+  auto v = data::vector<checked_union>{};
+  for (auto i = 0U; i != 3U; ++i) {
+    v.push_back(checked_union{i});
+  }
+  auto buf = cista::serialize(v);
+
+  union_deserialize_calls = 0U;
+  auto const d = cista::deserialize<data::vector<checked_union>>(buf);
+  CHECK(d->size() == 3U);
+  CHECK(union_deserialize_calls == 3U);
+}
+
+TEST_CASE("trivially serializable columns round trip") {
+  auto c = make_columns();
+  check_columns_round_trip<cista::mode::NONE>(c);
+  check_columns_round_trip<cista::mode::SERIALIZE_BIG_ENDIAN>(c);
+}
+
+TEST_CASE("vector element invariants are still checked") {
+  auto v = data::vector<cista::optional<std::uint32_t>>{};
+  v.emplace_back(1U);
+  v.emplace_back(2U);
+
+  auto buf = cista::serialize(v);
+  CHECK(cista::deserialize<decltype(v)>(buf)->at(1).value() == 2U);
+
+  auto const& last = v.back();
+  auto const valid_offset =
+      reinterpret_cast<std::uint8_t const*>(&last.valid_) -
+      reinterpret_cast<std::uint8_t const*>(&last);
+  buf[buf.size() - sizeof(last) + static_cast<std::size_t>(valid_offset)] = 7U;
+  CHECK_THROWS(cista::deserialize<decltype(v)>(buf));
+}
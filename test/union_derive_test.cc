@@ -55,6 +55,13 @@ TEST_CASE("derive_test") {
 
 union union_type {
   union_type() : type_{type_t::NONE} {}
+  union_type(union_type&& o) noexcept : type_{o.type_} {
+    switch (type_) {
+      case type_t::MAP: new (&a_) a{std::move(o.a_)}; break;
+      case type_t::VEC: new (&b_) b{std::move(o.b_)}; break;
+      case type_t::NONE: break;
+    }
+  }
   ~union_type() {
     switch (type_) {
       case type_t::MAP: a_.~a(); break;
@@ -124,4 +131,31 @@ TEST_CASE("complex union") {
   ss << *u;
   auto const check = ss.str() == "1, 2\n3, 4\n" || ss.str() == "3, 4\n1, 2\n";
   CHECK(check);
-}
\ No newline at end of file
+}
+TEST_CASE("complex union in vector") {
+  static_assert(
+      !cista::is_trivially_serializable_v<union_type, cista::mode::NONE>);
+
+  cista::byte_buf buf;
+  {
+    auto v = data::vector<union_type>{};
+    v.emplace_back();
+    new (&v.back().a_) union_type::a{};
+    v.back().type_ = union_type::type_t::MAP;
+    v.back().a_.map_ = {{1, 2}, {3, 4}};
+    v.emplace_back();
+    buf = cista::serialize(v);
+  }
+
+  auto const v = cista::deserialize<data::vector<union_type>>(buf);
+  REQUIRE(v->size() == 2U);
+
+  std::stringstream ss;
+  ss << (*v)[0];
+  auto const check = ss.str() == "1, 2\n3, 4\n" || ss.str() == "3, 4\n1, 2\n";
+  CHECK(check);
+
+  ss.str("");
+  ss << (*v)[1];
+  CHECK(ss.str() == "{empty}");
+}
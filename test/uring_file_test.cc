@@ -0,0 +1,99 @@
+#ifdef __linux__
+
+#include "doctest.h"
+
+#ifdef SINGLE_HEADER
+#include "cista.h"
+#else
+#include "cista/serialization.h"
+#include "cista/targets/uring_file.h"
+#endif
+
+namespace uring_file_test {
+
+namespace data = cista::offset;
+
+// The pointers precede their targets: they are fixed up while the buffers
+// holding them are in flight or already written (queued patches).
+struct dataset {
+  data::vector<data::ptr<std::uint64_t>> refs_;
+  data::indexed_vector<std::uint64_t> values_;
+  data::vector<data::vector<std::uint32_t>> groups_;
+};
+
+dataset make_dataset() {
+  auto d = dataset{};
+  for (auto i = 0U; i != 50'000U; ++i) {
+    d.values_.emplace_back(i * 7U);
+  }
+  for (auto i = 0U; i != 50'000U; i += 100U) {
+    d.refs_.emplace_back(&d.values_[i]);
+  }
+  for (auto i = 0U; i != 5'000U; ++i) {
+    d.groups_.emplace_back(data::vector<std::uint32_t>{i, i + 1U, i + 2U});
+  }
+  return d;
+}
+
+cista::byte_buf read_file(char const* path) {
+  auto b = cista::file{path, "r"}.content();
+  return cista::byte_buf{b.data(), b.data() + b.size()};
+}
+
+// The synchronous pwrite writer with the same buffer size is the reference
+// (its output is compared to serialize() in buffered_file_test).
+template <cista::mode Mode>
+void check_same_as_pwrite(std::size_t const buffer_size,
+                          cista::uring_writer::options const& o) {
+  constexpr auto const URING_FILENAME = "uring_file.bin";
+  constexpr auto const PWRITE_FILENAME = "uring_file_pwrite.bin";
+  auto d = make_dataset();
+  {
+    auto f = cista::uring_file{URING_FILENAME, buffer_size,
+                               cista::uring_file::durability::NONE, o};
+    cista::serialize<Mode>(f, d);
+  }
+  {
+    auto f = cista::buffered_file{PWRITE_FILENAME, buffer_size};
+    cista::serialize<Mode>(f, d);
+  }
+  auto b = read_file(URING_FILENAME);
+  CHECK(b == read_file(PWRITE_FILENAME));
+
+  auto const e = cista::deserialize<dataset, Mode>(b);
+  REQUIRE(e->refs_.size() == 500U);
+  CHECK(e->refs_[499U] == &e->values_[49'900U]);
+  CHECK(*e->refs_[499U] == 49'900U * 7U);
+  CHECK(e->groups_[4'999U][2U] == 5'001U);
+}
+
+}  // namespace uring_file_test
+
+using namespace uring_file_test;
+
+TEST_CASE("uring_file output equals pwrite output") {
+  auto const configurations = {
+      cista::uring_writer::options{},
+      cista::uring_writer::options{2U, false, true},
+      cista::uring_writer::options{4U, true, true},
+      cista::uring_writer::options{4U, false, false}};  // pwrite fallback
+  for (auto const& o : configurations) {
+    for (auto const buffer_size :
+         {std::size_t{4096U}, std::size_t{16U * 4096U},
+          cista::uring_file::DEFAULT_BUFFER_SIZE}) {
+      check_same_as_pwrite<cista::mode::NONE>(buffer_size, o);
+      check_same_as_pwrite<cista::mode::WITH_VERSION |
+                           cista::mode::WITH_INTEGRITY>(buffer_size, o);
+      check_same_as_pwrite<cista::mode::WITH_BLOCK_INTEGRITY>(buffer_size, o);
+    }
+  }
+}
+
+TEST_CASE("uring_file direct io requires aligned buffers") {
+  CHECK_THROWS(cista::uring_file{"uring_file_unaligned.bin", 1000U,
+                                 cista::uring_file::durability::NONE,
+                                 cista::uring_writer::options{4U, true, true}});
+  std::remove("uring_file_unaligned.bin");
+}
+
+#endif
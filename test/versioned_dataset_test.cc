@@ -0,0 +1,121 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "doctest.h"
+
+#ifdef SINGLE_HEADER
+#include "cista.h"
+#else
+#include "cista/serialization.h"
+#include "cista/versioned_dataset.h"
+#endif
+
+namespace versioned_dataset_test {
+
+namespace data = cista::offset;
+
+struct dataset {
+  std::uint64_t version_{0U};
+  data::vector<std::uint64_t> values_;  // all equal to version_
+};
+
+cista::wrapped<dataset> make_version(std::uint64_t const v) {
+  auto d = dataset{};
+  d.version_ = v;
+  d.values_.resize(1'000U, v);
+  auto b = cista::serialize(d);
+  auto const el = cista::deserialize<dataset>(b);
+  return cista::wrapped<dataset>{std::move(b), el};
+}
+
+}  // namespace versioned_dataset_test
+
+using namespace versioned_dataset_test;
+
+TEST_CASE("versioned dataset snapshots keep their version") {
+  auto d = cista::versioned_dataset<dataset>{};
+  CHECK(!d.acquire());
+  CHECK(d.current_version() == 0U);
+
+  CHECK(d.publish(make_version(10U)) == 1U);
+  auto s1 = d.acquire();
+  REQUIRE(s1);
+  CHECK(s1->version_ == 10U);
+  CHECK(s1.version() == 1U);
+
+  CHECK(d.publish(make_version(20U)) == 2U);
+  CHECK(!d.reclaim());  // s1 still reads version 1
+  CHECK(s1->values_[999U] == 10U);
+  CHECK(d.acquire()->version_ == 20U);
+
+  s1.release();
+  CHECK(d.reclaim());
+  CHECK(d.current_version() == 2U);
+}
+
+TEST_CASE("versioned dataset load from file") {
+  constexpr auto const FILENAME = "versioned_dataset.bin";
+  constexpr auto const TMP_FILENAME = "versioned_dataset.bin.tmp";
+  constexpr auto const MODE =
+      cista::mode::WITH_VERSION | cista::mode::WITH_INTEGRITY;
+
+  auto d = cista::versioned_dataset<dataset>{};
+  for (auto v = 1U; v != 4U; ++v) {
+    {
+      auto x = dataset{};
+      x.version_ = v;
+      x.values_.resize(100U, v);
+      auto f = cista::file{TMP_FILENAME, "w+"};
+      cista::serialize<MODE>(f, x);
+    }
+    std::rename(TMP_FILENAME, FILENAME);
+    CHECK(d.load_async<MODE>(FILENAME).get() == v);
+    auto const s = d.acquire();
+    CHECK(s->version_ == v);
+    CHECK(s->values_.size() == 100U);
+  }
+
+  {
+    auto f = cista::file{TMP_FILENAME, "w+"};
+    f.write("invalid", 7U, 0U);
+  }
+  std::rename(TMP_FILENAME, FILENAME);
+  CHECK_THROWS(d.load<MODE>(FILENAME));
+  CHECK(d.acquire()->version_ == 3U);
+}
+
+TEST_CASE("versioned dataset concurrent readers") {
+  auto d = cista::versioned_dataset<dataset>{};
+  d.publish(make_version(1U));
+
+  auto stop = std::atomic_bool{false};
+  auto errors = std::atomic_size_t{0U};
+  auto readers = std::vector<std::thread>{};
+  for (auto i = 0U; i != 4U; ++i) {
+    readers.emplace_back([&]() {
+      auto last = std::uint64_t{0U};
+      while (!stop.load()) {
+        auto const s = d.acquire();
+        auto const v = s->version_;
+        if (v < last || s->values_.size() != 1'000U ||
+            s->values_[v % 1'000U] != v) {
+          ++errors;
+        }
+        last = v;
+      }
+    });
+  }
+
+  for (auto v = 2U; v != 200U; ++v) {
+    d.publish(make_version(v));
+  }
+  stop = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+
+  CHECK(errors == 0U);
+  CHECK(d.acquire()->version_ == 199U);
+  CHECK(d.reclaim());
+}
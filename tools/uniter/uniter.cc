@@ -60,6 +60,8 @@ int main(int argc, char const** argv) {
   std::cout << "#pragma once\n\n";
   std::set<std::string> included;
   for (int i = 3; i < argc; ++i) {
-    write_file(include_path, argv[i], included);
+    if (included.insert(argv[i]).second) {
+      write_file(include_path, argv[i], included);
+    }
   }
 }
\ No newline at end of file